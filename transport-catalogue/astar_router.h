@@ -0,0 +1,303 @@
+#pragma once
+
+#include "graph.h"
+#include "path_key.h"
+#include "router.h"
+#include "search_state.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Отвечает на запросы BuildRoute поиском A* по требованию. Вершины выбираются по сумме пройденного
+// веса и нижней оценки оставшегося пути, поэтому поиск уходит от цели меньше, чем поиск Дейкстры.
+// Оценка — максимум из внешней оценки (например, по координатам) и оценки ALT по ориентирам:
+// из неравенства треугольника d(v, t) >= d(L, t) - d(L, v) и d(v, t) >= d(v, L) - d(t, L).
+// Обе оценки должны быть согласованными, тогда первый извлечённый из кучи путь до цели кратчайший.
+// Пути сравниваются по ключу PathKey, как у DijkstraRouter: оценка добавляется только к весу ключа,
+// поэтому из путей равного веса выбирается тот же, что и у поиска Дейкстры.
+// Константные методы потокобезопасны.
+template <typename Weight>
+class AStarRouter {
+    static_assert(std::numeric_limits<Weight>::has_infinity, "Weight should be able to represent infinity");
+
+public:
+    using Graph = DirectedWeightedGraph<Weight>;
+    using RouteInfo = typename Router<Weight>::RouteInfo;
+    // Нижняя оценка веса пути из from в to
+    using LowerBound = std::function<Weight(VertexId from, VertexId to)>;
+
+    // Расстояния от ориентиров и до них построчно: ячейка (i, v) имеет индекс i * vertex_count + v.
+    // Недостижимость кодируется бесконечным весом
+    struct Landmarks {
+        std::vector<VertexId> vertices;
+        std::vector<Weight> distances_from;
+        std::vector<Weight> distances_to;
+    };
+
+    // Выбирает ориентиры поочерёдно как самые удалённые от уже выбранных вершины и считает расстояния
+    static Landmarks ComputeLandmarks(const Graph& graph, size_t landmark_count);
+
+    // Выбрасывает std::invalid_argument, если размеры таблиц ориентиров или число стоимостей выбора
+    // не соответствуют графу
+    AStarRouter(const Graph& graph, const std::vector<TieCost>& tie_costs, Landmarks landmarks,
+                LowerBound lower_bound = {});
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    const Landmarks& GetLandmarks() const;
+
+private:
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr Weight UNREACHABLE = std::numeric_limits<Weight>::infinity();
+
+    using Key = PathKey<Weight>;
+    using State = SearchState<Key>;
+    // Расстояниям до ориентиров стоимости выбора не нужны
+    using LandmarkState = SearchState<Weight>;
+
+    // Оценки вершин вычисляются при первом достижении в текущем поиске
+    struct QueryState {
+        explicit QueryState(size_t vertex_count)
+            : search(vertex_count)
+            , potentials(vertex_count) {
+        }
+
+        State search;
+        std::vector<Weight> potentials;
+    };
+
+    // Расстояния от ориентира до всех вершин либо, если передан индекс входящих рёбер, от всех вершин до него
+    static std::vector<Weight> ComputeDistances(const Graph& graph, VertexId landmark,
+                                                const IncomingEdgesIndex* incoming_edges = nullptr);
+
+    Weight GetPotential(VertexId vertex, VertexId to) const;
+
+    const Graph& graph_;
+    const std::vector<TieCost>& tie_costs_;
+    Landmarks landmarks_;
+    LowerBound lower_bound_;
+
+    SearchStatePool<QueryState> states_;
+};
+
+template <typename Weight>
+typename AStarRouter<Weight>::Landmarks AStarRouter<Weight>::ComputeLandmarks(const Graph& graph,
+                                                                              size_t landmark_count) {
+    const size_t vertex_count = graph.GetVertexCount();
+
+    Landmarks landmarks;
+    landmark_count = std::min(landmark_count, vertex_count);
+    if (landmark_count == 0) {
+        return landmarks;
+    }
+
+    // Расстояния до ориентиров ищутся против направления рёбер. Индекс нужен только здесь,
+    // поэтому строится на время выбора ориентиров и не хранится
+    const IncomingEdgesIndex incoming_edges(graph);
+
+    // Для каждой вершины — наименьшее расстояние до неё от выбранных ориентиров (или от вершины 0,
+    // пока ориентиров нет). Следующий ориентир — достижимая вершина с наибольшим таким расстоянием
+    std::vector<Weight> closest_distances = ComputeDistances(graph, 0);
+    while (landmarks.vertices.size() < landmark_count) {
+        std::optional<VertexId> farthest;
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            const Weight distance = closest_distances[vertex];
+            if (distance != UNREACHABLE && (!farthest || closest_distances[*farthest] < distance)) {
+                farthest = vertex;
+            }
+        }
+        if (!farthest || (!landmarks.vertices.empty() && closest_distances[*farthest] == ZERO_WEIGHT)) {
+            break;
+        }
+
+        const auto distances_from = ComputeDistances(graph, *farthest);
+        const auto distances_to = ComputeDistances(graph, *farthest, &incoming_edges);
+
+        if (landmarks.vertices.empty()) {
+            closest_distances = distances_from;
+        } else {
+            for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+                closest_distances[vertex] = std::min(closest_distances[vertex], distances_from[vertex]);
+            }
+        }
+
+        landmarks.vertices.push_back(*farthest);
+        landmarks.distances_from.insert(landmarks.distances_from.end(), distances_from.begin(), distances_from.end());
+        landmarks.distances_to.insert(landmarks.distances_to.end(), distances_to.begin(), distances_to.end());
+    }
+
+    return landmarks;
+}
+
+template <typename Weight>
+AStarRouter<Weight>::AStarRouter(const Graph& graph, const std::vector<TieCost>& tie_costs, Landmarks landmarks,
+                                 LowerBound lower_bound)
+    : graph_(graph)
+    , tie_costs_(tie_costs)
+    , landmarks_(std::move(landmarks))
+    , lower_bound_(std::move(lower_bound))
+    , states_(graph.GetVertexCount())
+{
+    for (const auto& edge : graph.GetEdges()) {
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+
+    if (tie_costs.size() != graph.GetEdgeCount()) {
+        throw std::invalid_argument("Tie costs do not match edge count");
+    }
+
+    const size_t table_size = landmarks_.vertices.size() * graph.GetVertexCount();
+    if (landmarks_.distances_from.size() != table_size || landmarks_.distances_to.size() != table_size) {
+        throw std::invalid_argument("Landmark distances do not match vertex count");
+    }
+}
+
+template <typename Weight>
+const typename AStarRouter<Weight>::Landmarks& AStarRouter<Weight>::GetLandmarks() const {
+    return landmarks_;
+}
+
+template <typename Weight>
+std::vector<Weight> AStarRouter<Weight>::ComputeDistances(const Graph& graph, VertexId landmark,
+                                                          const IncomingEdgesIndex* incoming_edges) {
+    LandmarkState state(graph.GetVertexCount());
+    state.Reset();
+    state.Reach(landmark, ZERO_WEIGHT, LandmarkState::NO_EDGE);
+    state.Push(landmark, ZERO_WEIGHT);
+
+    const auto relax = [&state](const Weight& weight, VertexId head, EdgeId edge_id) {
+        if (!state.IsReached(head) || weight < state.weights[head]) {
+            state.Reach(head, weight, edge_id);
+            state.Push(head, weight);
+        }
+    };
+
+    while (!state.heap.empty()) {
+        const auto entry = state.Pop();
+        if (state.IsStale(entry)) {
+            continue;
+        }
+        if (incoming_edges) {
+            for (const EdgeId edge_id : incoming_edges->GetIncomingEdges(entry.vertex)) {
+                const auto& edge = graph.GetEdge(edge_id);
+                relax(entry.weight + edge.weight, edge.from, edge_id);
+            }
+        } else {
+            for (const EdgeId edge_id : graph.GetIncidentEdges(entry.vertex)) {
+                const auto& edge = graph.GetEdge(edge_id);
+                relax(entry.weight + edge.weight, edge.to, edge_id);
+            }
+        }
+    }
+
+    std::vector<Weight> distances(graph.GetVertexCount(), UNREACHABLE);
+    for (VertexId vertex = 0; vertex < graph.GetVertexCount(); ++vertex) {
+        if (state.IsReached(vertex)) {
+            distances[vertex] = state.weights[vertex];
+        }
+    }
+    return distances;
+}
+
+// Недостижимость через бесконечности отсекается автоматически: если вершина достижима из ориентира,
+// а цель нет (или наоборот для расстояний до ориентира), из вершины цель недостижима и оценка бесконечна.
+// Разность двух бесконечностей даёт NaN, и такая оценка пропускается сравнением
+template <typename Weight>
+Weight AStarRouter<Weight>::GetPotential(VertexId vertex, VertexId to) const {
+    Weight potential = lower_bound_ ? lower_bound_(vertex, to) : ZERO_WEIGHT;
+
+    const size_t vertex_count = graph_.GetVertexCount();
+    for (size_t index = 0; index < landmarks_.vertices.size(); ++index) {
+        const Weight* distances_from = landmarks_.distances_from.data() + index * vertex_count;
+        const Weight* distances_to = landmarks_.distances_to.data() + index * vertex_count;
+
+        const Weight forward_bound = distances_from[to] - distances_from[vertex];
+        if (forward_bound > potential) {
+            potential = forward_bound;
+        }
+        const Weight backward_bound = distances_to[vertex] - distances_to[to];
+        if (backward_bound > potential) {
+            potential = backward_bound;
+        }
+    }
+
+    return potential;
+}
+
+template <typename Weight>
+std::optional<typename AStarRouter<Weight>::RouteInfo> AStarRouter<Weight>::BuildRoute(VertexId from,
+                                                                                       VertexId to) const {
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    auto query_state = states_.Acquire();
+    State& state = query_state->search;
+    auto& potentials = query_state->potentials;
+
+    // Ключ в куче — ключ пройденного пути с оценкой, прибавленной к весу
+    const auto estimate = [&potentials](VertexId vertex, const Key& key) {
+        return Key{key.weight + potentials[vertex], key.tie};
+    };
+
+    state.Reset();
+    state.Reach(from, {}, State::NO_EDGE);
+    potentials[from] = GetPotential(from, to);
+    if (potentials[from] != UNREACHABLE) {
+        state.Push(from, estimate(from, {}));
+    }
+
+    bool is_found = false;
+    while (!state.heap.empty()) {
+        const auto entry = state.Pop();
+        if (estimate(entry.vertex, state.weights[entry.vertex]) < entry.weight) {
+            continue;
+        }
+        if (entry.vertex == to) {
+            is_found = true;
+            break;
+        }
+
+        const Key key = state.weights[entry.vertex];
+        for (const EdgeId edge_id : graph_.GetIncidentEdges(entry.vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const Key candidate_key = key + Key{edge.weight, tie_costs_[edge_id]};
+
+            if (!state.IsReached(edge.to)) {
+                potentials[edge.to] = GetPotential(edge.to, to);
+            } else if (!(candidate_key < state.weights[edge.to])) {
+                continue;
+            }
+            state.Reach(edge.to, candidate_key, edge_id);
+            if (potentials[edge.to] != UNREACHABLE) {
+                state.Push(edge.to, estimate(edge.to, candidate_key));
+            }
+        }
+    }
+
+    std::optional<RouteInfo> result;
+    if (is_found) {
+        std::vector<EdgeId> edges;
+        for (EdgeId edge_id = state.prev_edges[to]; edge_id != State::NO_EDGE;
+             edge_id = state.prev_edges[graph_.GetEdge(edge_id).from])
+        {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+        result = RouteInfo{state.weights[to].weight, std::move(edges)};
+    }
+
+    states_.Release(std::move(query_state));
+    return result;
+}
+
+}  // namespace graph
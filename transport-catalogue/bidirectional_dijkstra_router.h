@@ -0,0 +1,169 @@
+#pragma once
+
+#include "graph.h"
+#include "path_key.h"
+#include "router.h"
+#include "search_state.h"
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Отвечает на запросы BuildRoute двунаправленным поиском Дейкстры: прямой поиск идёт из from
+// по исходящим рёбрам, обратный — из to по входящим, и на каждом шаге продолжается тот, у которого
+// легче вершина кучи. Каждое ребро, соединяющее достигнутые обоими поисками вершины, даёт путь-кандидат.
+// Поиск останавливается, когда сумма весов вершин обеих куч не меньше лучшего кандидата:
+// более короткий путь должен был бы пройти через ещё не извлечённые вершины обеих сторон.
+// Вместо шара радиуса d(from, to) просматриваются два шара примерно вдвое меньшего радиуса.
+// Пути сравниваются по ключу PathKey, как у DijkstraRouter, поэтому и маршрут выбирается тот же.
+// Индекс входящих рёбер для обратного поиска строится в конструкторе. Константные методы потокобезопасны.
+template <typename Weight>
+class BidirectionalDijkstraRouter {
+public:
+    using Graph = DirectedWeightedGraph<Weight>;
+    using RouteInfo = typename Router<Weight>::RouteInfo;
+
+    // Выбрасывает std::invalid_argument, если стоимостей выбора не столько же, сколько рёбер
+    BidirectionalDijkstraRouter(const Graph& graph, const std::vector<TieCost>& tie_costs);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+private:
+    static constexpr Weight ZERO_WEIGHT{};
+
+    using Key = PathKey<Weight>;
+    using State = SearchState<Key>;
+
+    struct QueryState {
+        explicit QueryState(size_t vertex_count)
+            : forward(vertex_count)
+            , backward(vertex_count) {
+        }
+
+        State forward;
+        State backward;
+    };
+
+    const Graph& graph_;
+    const std::vector<TieCost>& tie_costs_;
+    const IncomingEdgesIndex incoming_edges_;
+    SearchStatePool<QueryState> states_;
+};
+
+template <typename Weight>
+BidirectionalDijkstraRouter<Weight>::BidirectionalDijkstraRouter(const Graph& graph,
+                                                                 const std::vector<TieCost>& tie_costs)
+    : graph_(graph)
+    , tie_costs_(tie_costs)
+    , incoming_edges_(graph)
+    , states_(graph.GetVertexCount())
+{
+    if (tie_costs.size() != graph.GetEdgeCount()) {
+        throw std::invalid_argument("Tie costs do not match edge count");
+    }
+    for (const auto& edge : graph.GetEdges()) {
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename BidirectionalDijkstraRouter<Weight>::RouteInfo>
+BidirectionalDijkstraRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    auto state = states_.Acquire();
+    State& forward = state->forward;
+    State& backward = state->backward;
+
+    forward.Reset();
+    forward.Reach(from, {}, State::NO_EDGE);
+    forward.Push(from, {});
+    backward.Reset();
+    backward.Reach(to, {}, State::NO_EDGE);
+    backward.Push(to, {});
+
+    std::optional<Key> best_key;
+    VertexId meeting_vertex = from;
+    if (from == to) {
+        best_key = Key{};
+    }
+
+    const auto update_best = [&](VertexId vertex) {
+        if (forward.IsReached(vertex) && backward.IsReached(vertex)) {
+            const Key key = forward.weights[vertex] + backward.weights[vertex];
+            if (!best_key || key < *best_key) {
+                best_key = key;
+                meeting_vertex = vertex;
+            }
+        }
+    };
+
+    while (!forward.heap.empty() && !backward.heap.empty()) {
+        if (best_key && !(forward.Top().weight + backward.Top().weight < *best_key)) {
+            break;
+        }
+
+        const bool is_forward = !(backward.Top().weight < forward.Top().weight);
+        State& current = is_forward ? forward : backward;
+
+        const auto entry = current.Pop();
+        if (current.IsStale(entry)) {
+            continue;
+        }
+
+        const auto relax = [&](VertexId head, EdgeId edge_id) {
+            const Key key = entry.weight + Key{graph_.GetEdge(edge_id).weight, tie_costs_[edge_id]};
+            if (!current.IsReached(head) || key < current.weights[head]) {
+                current.Reach(head, key, edge_id);
+                current.Push(head, key);
+                update_best(head);
+            }
+        };
+
+        if (is_forward) {
+            for (const EdgeId edge_id : graph_.GetIncidentEdges(entry.vertex)) {
+                relax(graph_.GetEdge(edge_id).to, edge_id);
+            }
+        } else {
+            for (const EdgeId edge_id : incoming_edges_.GetIncomingEdges(entry.vertex)) {
+                relax(graph_.GetEdge(edge_id).from, edge_id);
+            }
+        }
+    }
+
+    std::optional<RouteInfo> result;
+    if (best_key) {
+        std::vector<EdgeId> edges;
+        for (EdgeId edge_id = forward.prev_edges[meeting_vertex]; edge_id != State::NO_EDGE;
+             edge_id = forward.prev_edges[graph_.GetEdge(edge_id).from])
+        {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+        for (EdgeId edge_id = backward.prev_edges[meeting_vertex]; edge_id != State::NO_EDGE;
+             edge_id = backward.prev_edges[graph_.GetEdge(edge_id).to])
+        {
+            edges.push_back(edge_id);
+        }
+
+        // Вес складывается по рёбрам в порядке маршрута, как у DijkstraRouter
+        Weight weight = ZERO_WEIGHT;
+        for (const EdgeId edge_id : edges) {
+            weight = weight + graph_.GetEdge(edge_id).weight;
+        }
+        result = RouteInfo{weight, std::move(edges)};
+    }
+
+    states_.Release(std::move(state));
+    return result;
+}
+
+}  // namespace graph
@@ -0,0 +1,585 @@
+#pragma once
+
+#include "graph.h"
+#include "path_key.h"
+#include "router.h"
+#include "search_state.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Отвечает на запросы BuildRoute по иерархии сжатия (contraction hierarchies).
+// При предподсчёте вершины по очереди стягиваются: путь u → v → w через стягиваемую вершину v
+// заменяется ребром-сокращением u → w, если без v нет пути не длиннее. Порядок стягивания
+// задаёт ранг вершины. Запрос — двунаправленный поиск Дейкстры только по рёбрам, ведущим
+// к вершинам большего ранга, после чего сокращения раскрываются в рёбра исходного графа.
+// Стягивание и запрос сравнивают пути по ключу PathKey, как DijkstraRouter, поэтому маршрут тот же.
+// Стоимость выбора сокращения — сумма стоимостей заменённых им рёбер, в базе она не хранится.
+// Память линейна по числу рёбер графа и сокращений. Константные методы потокобезопасны.
+template <typename Weight>
+class ContractionHierarchyRouter {
+public:
+    using Graph = DirectedWeightedGraph<Weight>;
+    using RouteInfo = typename Router<Weight>::RouteInfo;
+
+    // Идентификаторы рёбер иерархии: сначала рёбра исходного графа,
+    // затем сокращения по порядку (сокращение i имеет идентификатор edge_count + i).
+    // Сокращение заменяет пару рёбер first_edge и second_edge, добавленных раньше него
+    struct Shortcut {
+        VertexId from;
+        VertexId to;
+        Weight weight;
+        EdgeId first_edge;
+        EdgeId second_edge;
+    };
+
+    struct Hierarchy {
+        std::vector<VertexId> ranks;
+        std::vector<Shortcut> shortcuts;
+    };
+
+    // Строит иерархию по графу.
+    // Выбрасывает std::invalid_argument, если стоимостей выбора не столько же, сколько рёбер
+    ContractionHierarchyRouter(const Graph& graph, const std::vector<TieCost>& tie_costs);
+    // Использует готовую иерархию, например загруженную из базы.
+    // Выбрасывает std::invalid_argument, если она или стоимости выбора не соответствуют графу
+    ContractionHierarchyRouter(const Graph& graph, const std::vector<TieCost>& tie_costs, Hierarchy hierarchy);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    const Hierarchy& GetHierarchy() const;
+
+private:
+    static constexpr Weight ZERO_WEIGHT{};
+    // Поиск свидетеля при стягивании прерывается после стольких вершин, и тогда
+    // сокращение добавляется без проверки: лишнее сокращение не нарушает корректность
+    static constexpr size_t WITNESS_SETTLE_LIMIT = 500;
+    // При оценке приоритета вершины достаточно приблизительного числа сокращений
+    static constexpr size_t SIMULATION_SETTLE_LIMIT = 50;
+
+    using Key = PathKey<Weight>;
+    using State = SearchState<Key>;
+
+    struct QueryState {
+        explicit QueryState(size_t vertex_count)
+            : forward(vertex_count)
+            , backward(vertex_count) {
+        }
+
+        State forward;
+        State backward;
+    };
+
+    // Ребро иерархии с точки зрения направления поиска: head — вершина, в которую оно ведёт поиск
+    struct Arc {
+        VertexId head;
+        Key key;
+        EdgeId edge;
+    };
+
+    // Рёбра поиска одного направления в CSR-виде
+    struct SearchGraph {
+        std::vector<size_t> offsets;
+        std::vector<Arc> arcs;
+
+        auto GetArcs(VertexId vertex) const {
+            return ranges::Range{arcs.begin() + offsets[vertex], arcs.begin() + offsets[vertex + 1]};
+        }
+    };
+
+    class Contractor;
+
+    void ValidateWeights() const;
+    void ValidateHierarchy() const;
+    void ComputeShortcutTies();
+    void BuildSearchGraphs();
+
+    Edge<Weight> GetHierarchyEdge(EdgeId edge_id) const;
+    Key GetHierarchyKey(EdgeId edge_id) const;
+    void UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const;
+
+    const Graph& graph_;
+    const std::vector<TieCost>& tie_costs_;
+    Hierarchy hierarchy_;
+    // Стоимости выбора сокращений по порядку
+    std::vector<TieCost> shortcut_ties_;
+
+    // upward_ ведёт из вершины к соседям большего ранга, downward_ — против направления рёбер,
+    // тоже к соседям большего ранга
+    SearchGraph upward_;
+    SearchGraph downward_;
+
+    SearchStatePool<QueryState> states_;
+};
+
+// Стягивает вершины в порядке возрастания приоритета «число сокращений минус число удаляемых рёбер
+// плюс число уже стянутых соседей». Приоритеты обновляются лениво: вершина с минимальным приоритетом
+// пересчитывается и стягивается, только если осталась минимальной.
+template <typename Weight>
+class ContractionHierarchyRouter<Weight>::Contractor {
+public:
+    Contractor(const Graph& graph, const std::vector<TieCost>& tie_costs)
+        : graph_(graph)
+        , out_arcs_(graph.GetVertexCount())
+        , in_arcs_(graph.GetVertexCount())
+        , deleted_neighbors_(graph.GetVertexCount(), 0)
+        , witness_(graph.GetVertexCount())
+        , is_target_(graph.GetVertexCount(), false) {
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            const auto& edge = graph.GetEdge(edge_id);
+            if (edge.from != edge.to) {
+                AddArc(edge.from, edge.to, {edge.weight, tie_costs[edge_id]}, edge_id);
+            }
+        }
+    }
+
+    Hierarchy Contract() {
+        using Candidate = std::pair<int64_t, VertexId>;
+        std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> queue;
+
+        const size_t vertex_count = graph_.GetVertexCount();
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            queue.push({GetPriority(vertex), vertex});
+        }
+
+        Hierarchy hierarchy;
+        hierarchy.ranks.resize(vertex_count);
+
+        VertexId rank = 0;
+        while (!queue.empty()) {
+            const VertexId vertex = queue.top().second;
+            queue.pop();
+
+            const int64_t priority = GetPriority(vertex);
+            if (!queue.empty() && priority > queue.top().first) {
+                queue.push({priority, vertex});
+                continue;
+            }
+
+            ContractVertex(vertex, &hierarchy.shortcuts);
+            hierarchy.ranks[vertex] = rank++;
+        }
+
+        return hierarchy;
+    }
+
+private:
+    int64_t GetPriority(VertexId vertex) {
+        const auto shortcut_count = static_cast<int64_t>(ContractVertex(vertex, nullptr));
+        return shortcut_count
+            - static_cast<int64_t>(in_arcs_[vertex].size() + out_arcs_[vertex].size())
+            + deleted_neighbors_[vertex];
+    }
+
+    // Возвращает число сокращений, необходимых при стягивании вершины.
+    // Если shortcuts равен nullptr, только подсчитывает их, не меняя граф
+    size_t ContractVertex(VertexId vertex, std::vector<Shortcut>* shortcuts) {
+        std::vector<std::pair<Shortcut, Key>> required;
+
+        for (const Arc& in_arc : in_arcs_[vertex]) {
+            const VertexId from = in_arc.head;
+
+            std::optional<Key> max_out_key;
+            for (const Arc& out_arc : out_arcs_[vertex]) {
+                if (out_arc.head != from && (!max_out_key || *max_out_key < out_arc.key)) {
+                    max_out_key = out_arc.key;
+                }
+            }
+            if (!max_out_key) {
+                continue;
+            }
+
+            FindWitnesses(from, vertex, in_arc.key + *max_out_key, out_arcs_[vertex],
+                          shortcuts ? WITNESS_SETTLE_LIMIT : SIMULATION_SETTLE_LIMIT);
+
+            for (const Arc& out_arc : out_arcs_[vertex]) {
+                const VertexId to = out_arc.head;
+                if (to == from) {
+                    continue;
+                }
+                const Key key = in_arc.key + out_arc.key;
+                if (!witness_.IsReached(to) || key < witness_.weights[to]) {
+                    required.push_back({{from, to, key.weight, in_arc.edge, out_arc.edge}, key});
+                }
+            }
+        }
+
+        if (shortcuts) {
+            for (const auto& [shortcut, key] : required) {
+                const EdgeId edge_id = graph_.GetEdgeCount() + shortcuts->size();
+                if (AddArc(shortcut.from, shortcut.to, key, edge_id)) {
+                    shortcuts->push_back(shortcut);
+                }
+            }
+            RemoveVertex(vertex);
+        }
+
+        return required.size();
+    }
+
+    // Поиск Дейкстры из from в оставшемся графе без вершины excluded, не дальше ключа max_key
+    // и не больше settle_limit вершин. Заканчивается, как только найдены кратчайшие пути до всех вершин targets
+    void FindWitnesses(VertexId from, VertexId excluded, const Key& max_key,
+                       const std::vector<Arc>& targets, size_t settle_limit) {
+        size_t target_count = 0;
+        for (const Arc& arc : targets) {
+            if (!is_target_[arc.head]) {
+                is_target_[arc.head] = true;
+                ++target_count;
+            }
+        }
+
+        witness_.Reset();
+        witness_.Reach(from, {}, State::NO_EDGE);
+        witness_.Push(from, {});
+
+        size_t settled_count = 0;
+        while (!witness_.heap.empty() && target_count > 0) {
+            const auto entry = witness_.Pop();
+            if (witness_.IsStale(entry)) {
+                continue;
+            }
+            if (max_key < entry.weight || ++settled_count > settle_limit) {
+                break;
+            }
+            if (is_target_[entry.vertex]) {
+                is_target_[entry.vertex] = false;
+                --target_count;
+            }
+
+            for (const Arc& arc : out_arcs_[entry.vertex]) {
+                if (arc.head == excluded) {
+                    continue;
+                }
+                const Key candidate_key = entry.weight + arc.key;
+                if (!witness_.IsReached(arc.head) || candidate_key < witness_.weights[arc.head]) {
+                    witness_.Reach(arc.head, candidate_key, arc.edge);
+                    witness_.Push(arc.head, candidate_key);
+                }
+            }
+        }
+
+        for (const Arc& arc : targets) {
+            is_target_[arc.head] = false;
+        }
+    }
+
+    // Добавляет ребро между оставшимися вершинами, если между ними ещё нет ребра не дороже.
+    // Возвращает, было ли ребро добавлено или заменило более дорогое
+    bool AddArc(VertexId from, VertexId to, const Key& key, EdgeId edge_id) {
+        auto& out_arcs = out_arcs_[from];
+        const auto out_it = std::find_if(out_arcs.begin(), out_arcs.end(), [to](const Arc& arc) {
+            return arc.head == to;
+        });
+
+        if (out_it == out_arcs.end()) {
+            out_arcs.push_back({to, key, edge_id});
+            in_arcs_[to].push_back({from, key, edge_id});
+            return true;
+        }
+        if (!(key < out_it->key)) {
+            return false;
+        }
+
+        *out_it = {to, key, edge_id};
+        auto& in_arcs = in_arcs_[to];
+        *std::find_if(in_arcs.begin(), in_arcs.end(), [from](const Arc& arc) {
+            return arc.head == from;
+        }) = {from, key, edge_id};
+        return true;
+    }
+
+    void RemoveVertex(VertexId vertex) {
+        const auto is_removed = [vertex](const Arc& arc) {
+            return arc.head == vertex;
+        };
+
+        for (const Arc& in_arc : in_arcs_[vertex]) {
+            auto& arcs = out_arcs_[in_arc.head];
+            arcs.erase(std::remove_if(arcs.begin(), arcs.end(), is_removed), arcs.end());
+            ++deleted_neighbors_[in_arc.head];
+        }
+        for (const Arc& out_arc : out_arcs_[vertex]) {
+            auto& arcs = in_arcs_[out_arc.head];
+            arcs.erase(std::remove_if(arcs.begin(), arcs.end(), is_removed), arcs.end());
+            ++deleted_neighbors_[out_arc.head];
+        }
+
+        in_arcs_[vertex] = {};
+        out_arcs_[vertex] = {};
+    }
+
+    const Graph& graph_;
+
+    // Рёбра между ещё не стянутыми вершинами: out_arcs_ по исходной вершине, in_arcs_ по конечной
+    std::vector<std::vector<Arc>> out_arcs_;
+    std::vector<std::vector<Arc>> in_arcs_;
+    std::vector<int64_t> deleted_neighbors_;
+
+    State witness_;
+    std::vector<bool> is_target_;
+};
+
+template <typename Weight>
+ContractionHierarchyRouter<Weight>::ContractionHierarchyRouter(const Graph& graph,
+                                                               const std::vector<TieCost>& tie_costs)
+    : graph_(graph)
+    , tie_costs_(tie_costs)
+    , states_(graph.GetVertexCount())
+{
+    ValidateWeights();
+    hierarchy_ = Contractor(graph, tie_costs).Contract();
+    ComputeShortcutTies();
+    BuildSearchGraphs();
+}
+
+template <typename Weight>
+ContractionHierarchyRouter<Weight>::ContractionHierarchyRouter(const Graph& graph,
+                                                               const std::vector<TieCost>& tie_costs,
+                                                               Hierarchy hierarchy)
+    : graph_(graph)
+    , tie_costs_(tie_costs)
+    , hierarchy_(std::move(hierarchy))
+    , states_(graph.GetVertexCount())
+{
+    ValidateWeights();
+    ValidateHierarchy();
+    ComputeShortcutTies();
+    BuildSearchGraphs();
+}
+
+template <typename Weight>
+const typename ContractionHierarchyRouter<Weight>::Hierarchy& ContractionHierarchyRouter<Weight>::GetHierarchy() const {
+    return hierarchy_;
+}
+
+template <typename Weight>
+void ContractionHierarchyRouter<Weight>::ValidateWeights() const {
+    if (tie_costs_.size() != graph_.GetEdgeCount()) {
+        throw std::invalid_argument("Tie costs do not match edge count");
+    }
+    for (const auto& edge : graph_.GetEdges()) {
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+void ContractionHierarchyRouter<Weight>::ValidateHierarchy() const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (hierarchy_.ranks.size() != vertex_count) {
+        throw std::invalid_argument("Contraction hierarchy ranks do not match vertex count");
+    }
+
+    std::vector<bool> is_rank_used(vertex_count, false);
+    for (const VertexId rank : hierarchy_.ranks) {
+        if (rank >= vertex_count || is_rank_used[rank]) {
+            throw std::invalid_argument("Contraction hierarchy ranks should be a permutation of vertices");
+        }
+        is_rank_used[rank] = true;
+    }
+
+    for (size_t index = 0; index < hierarchy_.shortcuts.size(); ++index) {
+        const auto& shortcut = hierarchy_.shortcuts[index];
+        const EdgeId edge_id = graph_.GetEdgeCount() + index;
+        if (shortcut.first_edge >= edge_id || shortcut.second_edge >= edge_id) {
+            throw std::invalid_argument("Shortcut should replace edges added before it");
+        }
+
+        const auto first = GetHierarchyEdge(shortcut.first_edge);
+        const auto second = GetHierarchyEdge(shortcut.second_edge);
+        if (first.from != shortcut.from || first.to != second.from || second.to != shortcut.to) {
+            throw std::invalid_argument("Shortcut edges do not form a path");
+        }
+    }
+}
+
+// Сокращение заменяет только добавленные раньше него рёбра, поэтому стоимости считаются за один проход
+template <typename Weight>
+void ContractionHierarchyRouter<Weight>::ComputeShortcutTies() {
+    shortcut_ties_.clear();
+    shortcut_ties_.reserve(hierarchy_.shortcuts.size());
+    for (const auto& shortcut : hierarchy_.shortcuts) {
+        shortcut_ties_.push_back(GetHierarchyKey(shortcut.first_edge).tie + GetHierarchyKey(shortcut.second_edge).tie);
+    }
+}
+
+template <typename Weight>
+void ContractionHierarchyRouter<Weight>::BuildSearchGraphs() {
+    const size_t vertex_count = graph_.GetVertexCount();
+    const size_t edge_count = graph_.GetEdgeCount() + hierarchy_.shortcuts.size();
+
+    // Каждое ребро, кроме петель, попадает ровно в один из графов поиска:
+    // в upward_ у вершины меньшего ранга, если ведёт вверх, иначе в downward_ у конечной вершины
+    for (SearchGraph* search_graph : {&upward_, &downward_}) {
+        search_graph->offsets.assign(vertex_count + 1, 0);
+    }
+    for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+        const auto edge = GetHierarchyEdge(edge_id);
+        if (edge.from == edge.to) {
+            continue;
+        }
+        if (hierarchy_.ranks[edge.from] < hierarchy_.ranks[edge.to]) {
+            ++upward_.offsets[edge.from + 1];
+        } else {
+            ++downward_.offsets[edge.to + 1];
+        }
+    }
+
+    for (SearchGraph* search_graph : {&upward_, &downward_}) {
+        auto& offsets = search_graph->offsets;
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            offsets[vertex + 1] += offsets[vertex];
+        }
+        search_graph->arcs.resize(offsets.back());
+    }
+
+    std::vector<size_t> upward_positions(upward_.offsets.begin(), upward_.offsets.end() - 1);
+    std::vector<size_t> downward_positions(downward_.offsets.begin(), downward_.offsets.end() - 1);
+    for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+        const auto edge = GetHierarchyEdge(edge_id);
+        if (edge.from == edge.to) {
+            continue;
+        }
+        if (hierarchy_.ranks[edge.from] < hierarchy_.ranks[edge.to]) {
+            upward_.arcs[upward_positions[edge.from]++] = {edge.to, GetHierarchyKey(edge_id), edge_id};
+        } else {
+            downward_.arcs[downward_positions[edge.to]++] = {edge.from, GetHierarchyKey(edge_id), edge_id};
+        }
+    }
+}
+
+template <typename Weight>
+Edge<Weight> ContractionHierarchyRouter<Weight>::GetHierarchyEdge(EdgeId edge_id) const {
+    if (edge_id < graph_.GetEdgeCount()) {
+        return graph_.GetEdge(edge_id);
+    }
+    const auto& shortcut = hierarchy_.shortcuts[edge_id - graph_.GetEdgeCount()];
+    return {shortcut.from, shortcut.to, shortcut.weight};
+}
+
+template <typename Weight>
+typename ContractionHierarchyRouter<Weight>::Key ContractionHierarchyRouter<Weight>::GetHierarchyKey(EdgeId edge_id) const {
+    if (edge_id < graph_.GetEdgeCount()) {
+        return {graph_.GetEdge(edge_id).weight, tie_costs_[edge_id]};
+    }
+    const size_t index = edge_id - graph_.GetEdgeCount();
+    return {hierarchy_.shortcuts[index].weight, shortcut_ties_[index]};
+}
+
+template <typename Weight>
+void ContractionHierarchyRouter<Weight>::UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const {
+    std::vector<EdgeId> stack = {edge_id};
+    while (!stack.empty()) {
+        const EdgeId current = stack.back();
+        stack.pop_back();
+
+        if (current < graph_.GetEdgeCount()) {
+            edges.push_back(current);
+        } else {
+            const auto& shortcut = hierarchy_.shortcuts[current - graph_.GetEdgeCount()];
+            stack.push_back(shortcut.second_edge);
+            stack.push_back(shortcut.first_edge);
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename ContractionHierarchyRouter<Weight>::RouteInfo>
+ContractionHierarchyRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    auto state = states_.Acquire();
+    State& forward = state->forward;
+    State& backward = state->backward;
+
+    forward.Reset();
+    forward.Reach(from, {}, State::NO_EDGE);
+    forward.Push(from, {});
+    backward.Reset();
+    backward.Reach(to, {}, State::NO_EDGE);
+    backward.Push(to, {});
+
+    std::optional<Key> best_key;
+    VertexId meeting_vertex = from;
+
+    // Каждый шаг продолжает направление с меньшим весом в вершине кучи.
+    // Кратчайший путь проходит через вершину наибольшего ранга на нём, которую оба поиска
+    // достигают с точными весами, поэтому можно остановиться, как только обе кучи не легче найденного
+    while (!forward.heap.empty() || !backward.heap.empty()) {
+        const bool is_forward = backward.heap.empty()
+            || (!forward.heap.empty() && !(backward.Top().weight < forward.Top().weight));
+        State& current = is_forward ? forward : backward;
+        const State& opposite = is_forward ? backward : forward;
+        const SearchGraph& search_graph = is_forward ? upward_ : downward_;
+
+        if (best_key && !(current.Top().weight < *best_key)) {
+            break;
+        }
+
+        const auto entry = current.Pop();
+        if (current.IsStale(entry)) {
+            continue;
+        }
+
+        if (opposite.IsReached(entry.vertex)) {
+            const Key key = entry.weight + opposite.weights[entry.vertex];
+            if (!best_key || key < *best_key) {
+                best_key = key;
+                meeting_vertex = entry.vertex;
+            }
+        }
+
+        for (const Arc& arc : search_graph.GetArcs(entry.vertex)) {
+            const Key candidate_key = entry.weight + arc.key;
+            if (!current.IsReached(arc.head) || candidate_key < current.weights[arc.head]) {
+                current.Reach(arc.head, candidate_key, arc.edge);
+                current.Push(arc.head, candidate_key);
+            }
+        }
+    }
+
+    std::optional<RouteInfo> result;
+    if (best_key) {
+        std::vector<EdgeId> hierarchy_edges;
+        for (EdgeId edge_id = forward.prev_edges[meeting_vertex]; edge_id != State::NO_EDGE;
+             edge_id = forward.prev_edges[GetHierarchyEdge(edge_id).from])
+        {
+            hierarchy_edges.push_back(edge_id);
+        }
+        std::reverse(hierarchy_edges.begin(), hierarchy_edges.end());
+        for (EdgeId edge_id = backward.prev_edges[meeting_vertex]; edge_id != State::NO_EDGE;
+             edge_id = backward.prev_edges[GetHierarchyEdge(edge_id).to])
+        {
+            hierarchy_edges.push_back(edge_id);
+        }
+
+        std::vector<EdgeId> edges;
+        for (const EdgeId edge_id : hierarchy_edges) {
+            UnpackEdge(edge_id, edges);
+        }
+
+        // Вес складывается по рёбрам исходного графа в порядке маршрута, как у DijkstraRouter
+        Weight weight = ZERO_WEIGHT;
+        for (const EdgeId edge_id : edges) {
+            weight = weight + graph_.GetEdge(edge_id).weight;
+        }
+        result = RouteInfo{weight, std::move(edges)};
+    }
+
+    states_.Release(std::move(state));
+    return result;
+}
+
+}  // namespace graph
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "graph.h"
+#include "path_key.h"
+#include "router.h"
+#include "search_state.h"
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Отвечает на запросы BuildRoute поиском Дейкстры из вершины from по требованию.
+// В отличие от Router не хранит таблицу V×V: предподсчёт и память линейны по размеру графа.
+// Пути сравниваются по ключу PathKey, поэтому среди равных по весу выбирается путь наименьшей стоимости выбора.
+// Буферы поиска переиспользуются между запросами и выдаются из пула,
+// поэтому константные методы можно вызывать из нескольких потоков одновременно.
+template <typename Weight>
+class DijkstraRouter {
+public:
+    using Graph = DirectedWeightedGraph<Weight>;
+    using RouteInfo = typename Router<Weight>::RouteInfo;
+
+    // Выбрасывает std::invalid_argument, если стоимостей выбора не столько же, сколько рёбер
+    DijkstraRouter(const Graph& graph, const std::vector<TieCost>& tie_costs);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+private:
+    static constexpr Weight ZERO_WEIGHT{};
+
+    using Key = PathKey<Weight>;
+    using State = SearchState<Key>;
+
+    void Search(State& state, VertexId from, VertexId to) const;
+
+    const Graph& graph_;
+    const std::vector<TieCost>& tie_costs_;
+    SearchStatePool<State> states_;
+};
+
+template <typename Weight>
+DijkstraRouter<Weight>::DijkstraRouter(const Graph& graph, const std::vector<TieCost>& tie_costs)
+    : graph_(graph)
+    , tie_costs_(tie_costs)
+    , states_(graph.GetVertexCount())
+{
+    if (tie_costs.size() != graph.GetEdgeCount()) {
+        throw std::invalid_argument("Tie costs do not match edge count");
+    }
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRoute(VertexId from,
+                                                                                             VertexId to) const {
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    auto state = states_.Acquire();
+    Search(*state, from, to);
+
+    std::optional<RouteInfo> result;
+    if (state->IsReached(to)) {
+        std::vector<EdgeId> edges;
+        for (EdgeId edge_id = state->prev_edges[to]; edge_id != State::NO_EDGE;
+             edge_id = state->prev_edges[graph_.GetEdge(edge_id).from])
+        {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+        result = RouteInfo{state->weights[to].weight, std::move(edges)};
+    }
+
+    states_.Release(std::move(state));
+    return result;
+}
+
+template <typename Weight>
+void DijkstraRouter<Weight>::Search(State& state, VertexId from, VertexId to) const {
+    state.Reset();
+    state.Reach(from, {}, State::NO_EDGE);
+    state.Push(from, {});
+
+    while (!state.heap.empty()) {
+        const auto entry = state.Pop();
+        if (state.IsStale(entry)) {
+            continue;
+        }
+        if (entry.vertex == to) {
+            return;
+        }
+
+        for (const EdgeId edge_id : graph_.GetIncidentEdges(entry.vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const Key candidate_key = entry.weight + Key{edge.weight, tie_costs_[edge_id]};
+            if (!state.IsReached(edge.to) || candidate_key < state.weights[edge.to]) {
+                state.Reach(edge.to, candidate_key, edge_id);
+                state.Push(edge.to, candidate_key);
+            }
+        }
+    }
+}
+
+}  // namespace graph
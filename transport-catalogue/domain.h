@@ -2,6 +2,7 @@
 
 #include "geo.h"
 
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <set>
@@ -20,9 +21,16 @@
 
 namespace transport_catalogue {
 
+// Плотные номера остановок и автобусов: порядок добавления в справочник.
+// По ним остальные модули индексируют массивы вместо хеширования указателей
+using StopId = std::uint32_t;
+using BusId = std::uint32_t;
+
 struct Stop {
     std::string name;
     geo::Coordinates coordinates;
+    // Назначается справочником при добавлении
+    StopId id = 0;
 };
 
 using StopPtr = const Stop*;
@@ -31,6 +39,8 @@ struct Bus {
     std::string name;
     bool is_roundtrip;
     std::vector<StopPtr> stops;
+    // Назначается справочником при добавлении
+    BusId id = 0;
 };
 
 using BusPtr = const Bus*;
@@ -4,6 +4,8 @@
 
 #include <cstddef>
 #include <cstdlib>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 namespace graph {
@@ -18,44 +20,79 @@ struct Edge {
     Weight weight;
 };
 
+// Неизменяемый граф в CSR-виде: рёбра упорядочены по исходной вершине и лежат в одном массиве,
+// а рёбра вершины v занимают в нём отрезок [offsets_[v], offsets_[v + 1]).
+// Идентификатор ребра — его позиция в этом массиве, поэтому исходящие рёбра вершины
+// имеют последовательные идентификаторы.
 template <typename Weight>
 class DirectedWeightedGraph {
 private:
-    using IncidenceList = std::vector<EdgeId>;
-    using IncidentEdgesRange = ranges::Range<typename IncidenceList::const_iterator>;
+    using IncidentEdgesRange = ranges::Range<ranges::IndexIterator<EdgeId>>;
 
 public:
     DirectedWeightedGraph() = default;
     explicit DirectedWeightedGraph(size_t vertex_count);
-
-    EdgeId AddEdge(const Edge<Weight>& edge);
+    // Рёбра должны быть упорядочены по исходной вершине
+    DirectedWeightedGraph(size_t vertex_count, std::vector<Edge<Weight>> edges);
 
     size_t GetVertexCount() const;
     size_t GetEdgeCount() const;
     const Edge<Weight>& GetEdge(EdgeId edge_id) const;
     IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
+    const std::vector<Edge<Weight>>& GetEdges() const;
 
 private:
     std::vector<Edge<Weight>> edges_;
-    std::vector<IncidenceList> incidence_lists_;
+    std::vector<EdgeId> offsets_ = {0};
+};
+
+// Идентификаторы рёбер графа, упорядоченные по конечной вершине, для поиска против направления рёбер.
+// Граф такой индекс не хранит: его строят только те, кому он нужен, и он занимает ещё ~8 байт на ребро
+class IncomingEdgesIndex {
+private:
+    using IncomingEdgesRange = ranges::Range<std::vector<EdgeId>::const_iterator>;
+
+public:
+    template <typename Weight>
+    explicit IncomingEdgesIndex(const DirectedWeightedGraph<Weight>& graph);
+
+    // Рёбра, входящие в вершину, в порядке возрастания идентификаторов
+    IncomingEdgesRange GetIncomingEdges(VertexId vertex) const {
+        return {edges_.begin() + offsets_[vertex], edges_.begin() + offsets_[vertex + 1]};
+    }
+
+private:
+    std::vector<EdgeId> edges_;
+    std::vector<EdgeId> offsets_;
 };
 
 template <typename Weight>
 DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count) :
-    incidence_lists_(vertex_count) {
+    offsets_(vertex_count + 1, 0) {
 }
 
 template <typename Weight>
-EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
-    edges_.push_back(edge);
-    const EdgeId id = edges_.size() - 1;
-    incidence_lists_.at(edge.from).push_back(id);
-    return id;
+DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count, std::vector<Edge<Weight>> edges) :
+    edges_(std::move(edges)),
+    offsets_(vertex_count + 1, 0) {
+    for (EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+        const auto& edge = edges_[edge_id];
+        if (edge.from >= vertex_count || edge.to >= vertex_count) {
+            throw std::out_of_range("Edge vertex is out of range");
+        }
+        if (edge_id > 0 && edges_[edge_id - 1].from > edge.from) {
+            throw std::invalid_argument("Edges should be sorted by source vertex");
+        }
+        ++offsets_[edge.from + 1];
+    }
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        offsets_[vertex + 1] += offsets_[vertex];
+    }
 }
 
 template <typename Weight>
 size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
-    return incidence_lists_.size();
+    return offsets_.size() - 1;
 }
 
 template <typename Weight>
@@ -65,12 +102,35 @@ size_t DirectedWeightedGraph<Weight>::GetEdgeCount() const {
 
 template <typename Weight>
 const Edge<Weight>& DirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id) const {
-    return edges_.at(edge_id);
+    return edges_[edge_id];
 }
 
 template <typename Weight>
 typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
 DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
-    return ranges::AsRange(incidence_lists_.at(vertex));
+    return ranges::AsIndexRange(offsets_[vertex], offsets_[vertex + 1]);
+}
+
+template <typename Weight>
+const std::vector<Edge<Weight>>& DirectedWeightedGraph<Weight>::GetEdges() const {
+    return edges_;
+}
+
+template <typename Weight>
+IncomingEdgesIndex::IncomingEdgesIndex(const DirectedWeightedGraph<Weight>& graph)
+    : edges_(graph.GetEdgeCount())
+    , offsets_(graph.GetVertexCount() + 1, 0)
+{
+    for (const auto& edge : graph.GetEdges()) {
+        ++offsets_[edge.to + 1];
+    }
+    for (VertexId vertex = 0; vertex < graph.GetVertexCount(); ++vertex) {
+        offsets_[vertex + 1] += offsets_[vertex];
+    }
+
+    std::vector<EdgeId> positions(offsets_.begin(), offsets_.end() - 1);
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        edges_[positions[graph.GetEdge(edge_id).to]++] = edge_id;
+    }
 }
 }  // namespace graph
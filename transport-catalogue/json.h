@@ -3,6 +3,7 @@
 #include <iostream>
 #include <map>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -155,8 +156,15 @@ inline bool operator!=(const Document& lhs, const Document& rhs) {
     return !(lhs == rhs);
 }
 
+// Разбирает первое значение буфера
+Document Load(std::string_view input);
+
+// Читает поток до конца и разбирает его первое значение
 Document Load(std::istream& input);
 
+// Читает поток до конца блоками, чтобы затем разобрать его как непрерывный буфер
+std::string ReadAll(std::istream& input);
+
 void Print(const Document& doc, std::ostream& output);
 
 }  // namespace json
@@ -0,0 +1,344 @@
+#include "json_parser.h"
+
+#include <charconv>
+#include <stdexcept>
+#include <utility>
+
+namespace json {
+
+using namespace std;
+
+namespace {
+
+// Те же пробельные символы, что пропускает operator>> потока
+bool IsSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+bool IsAlpha(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+}  // namespace
+
+void NodeBuilder::StartDict() {
+    Open(Dict{});
+}
+
+void NodeBuilder::Key(string_view key) {
+    frames_.back().key = key;
+}
+
+void NodeBuilder::EndDict() {
+    Close();
+}
+
+void NodeBuilder::StartArray() {
+    Open(Array{});
+}
+
+void NodeBuilder::EndArray() {
+    Close();
+}
+
+void NodeBuilder::Value(nullptr_t) {
+    Add(Node{nullptr});
+}
+
+void NodeBuilder::Value(bool value) {
+    Add(Node{value});
+}
+
+void NodeBuilder::Value(int value) {
+    Add(Node{value});
+}
+
+void NodeBuilder::Value(double value) {
+    Add(Node{value});
+}
+
+void NodeBuilder::Value(string_view value) {
+    Add(Node{string(value)});
+}
+
+bool NodeBuilder::IsComplete() const {
+    return is_complete_;
+}
+
+Node NodeBuilder::Extract() {
+    if (!is_complete_) {
+        throw logic_error("Value is not complete"s);
+    }
+    is_complete_ = false;
+    Node root = move(root_);
+    root_ = nullptr;
+    return root;
+}
+
+void NodeBuilder::Open(Node node) {
+    frames_.push_back({move(node), {}});
+}
+
+void NodeBuilder::Close() {
+    Node node = move(frames_.back().node);
+    frames_.pop_back();
+    Add(move(node));
+}
+
+void NodeBuilder::Add(Node node) {
+    if (frames_.empty()) {
+        root_ = move(node);
+        is_complete_ = true;
+        return;
+    }
+
+    auto& frame = frames_.back();
+    if (frame.node.IsArray()) {
+        frame.node.AsArray().push_back(move(node));
+    } else if (!frame.node.AsDict().try_emplace(move(frame.key), move(node)).second) {
+        throw ParsingError("Duplicate key '"s + frame.key + "' have been found");
+    }
+}
+
+Parser::Parser(string_view input)
+    : input_(input) {
+}
+
+Node Parser::ParseNode() {
+    NodeBuilder builder;
+    Parse(builder);
+    return builder.Extract();
+}
+
+char Parser::Peek() {
+    while (position_ < input_.size() && IsSpace(input_[position_])) {
+        ++position_;
+    }
+    if (position_ == input_.size()) {
+        throw ParsingError("Unexpected EOF"s);
+    }
+    return input_[position_];
+}
+
+void Parser::Expect(char c) {
+    if (const char actual = Peek(); actual != c) {
+        throw ParsingError("'"s + c + "' is expected but '"s + actual + "' has been found"s);
+    }
+    ++position_;
+}
+
+void Parser::Parse(Handler& handler) {
+    switch (Peek()) {
+        case '[':
+            ParseArray(handler);
+            break;
+        case '{':
+            ParseDict(handler);
+            break;
+        case '"':
+            handler.Value(ParseString());
+            break;
+        case 't':
+            [[fallthrough]];
+        case 'f': {
+            const auto literal = ParseLiteral();
+            if (literal == "true"sv) {
+                handler.Value(true);
+            } else if (literal == "false"sv) {
+                handler.Value(false);
+            } else {
+                throw ParsingError("Failed to parse '"s + string(literal) + "' as bool"s);
+            }
+            break;
+        }
+        case 'n': {
+            const auto literal = ParseLiteral();
+            if (literal != "null"sv) {
+                throw ParsingError("Failed to parse '"s + string(literal) + "' as null"s);
+            }
+            handler.Value(nullptr);
+            break;
+        }
+        default:
+            ParseNumber(handler);
+    }
+}
+
+void Parser::ParseArray(Handler& handler) {
+    Expect('[');
+    handler.StartArray();
+    if (Peek() == ']') {
+        ++position_;
+        handler.EndArray();
+        return;
+    }
+
+    while (true) {
+        Parse(handler);
+        if (Peek() == ']') {
+            ++position_;
+            handler.EndArray();
+            return;
+        }
+        Expect(',');
+    }
+}
+
+void Parser::ParseDict(Handler& handler) {
+    Expect('{');
+    handler.StartDict();
+    if (Peek() == '}') {
+        ++position_;
+        handler.EndDict();
+        return;
+    }
+
+    while (true) {
+        handler.Key(ParseString());
+        Expect(':');
+        Parse(handler);
+
+        if (Peek() == '}') {
+            ++position_;
+            handler.EndDict();
+            return;
+        }
+        Expect(',');
+    }
+}
+
+// Строки без escape-последовательностей не копируются. Иначе строка собирается в unescaped_,
+// начиная с уже просмотренного префикса без escape-последовательностей
+string_view Parser::ParseString() {
+    Expect('"');
+    const size_t begin = position_;
+
+    bool is_escaped = false;
+    while (true) {
+        if (position_ == input_.size()) {
+            throw ParsingError("String parsing error"s);
+        }
+
+        const char ch = input_[position_];
+        if (ch == '"') {
+            ++position_;
+            break;
+        } else if (ch == '\n' || ch == '\r') {
+            throw ParsingError("Unexpected end of line"s);
+        } else if (ch != '\\') {
+            if (is_escaped) {
+                unescaped_.push_back(ch);
+            }
+            ++position_;
+            continue;
+        }
+
+        if (!is_escaped) {
+            is_escaped = true;
+            unescaped_.assign(input_.substr(begin, position_ - begin));
+        }
+        if (++position_ == input_.size()) {
+            throw ParsingError("String parsing error"s);
+        }
+        const char escaped_char = input_[position_++];
+        switch (escaped_char) {
+            case 'n':
+                unescaped_.push_back('\n');
+                break;
+            case 't':
+                unescaped_.push_back('\t');
+                break;
+            case 'r':
+                unescaped_.push_back('\r');
+                break;
+            case '"':
+                unescaped_.push_back('"');
+                break;
+            case '\\':
+                unescaped_.push_back('\\');
+                break;
+            default:
+                throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
+        }
+    }
+
+    if (is_escaped) {
+        return unescaped_;
+    }
+    return input_.substr(begin, position_ - 1 - begin);
+}
+
+string_view Parser::ParseLiteral() {
+    Peek();
+    const size_t begin = position_;
+    while (position_ < input_.size() && IsAlpha(input_[position_])) {
+        ++position_;
+    }
+    return input_.substr(begin, position_ - begin);
+}
+
+// Грамматика числа проверяется так же, как раньше при чтении из потока: целое число,
+// не помещающееся в int, становится double
+void Parser::ParseNumber(Handler& handler) {
+    Peek();
+    const size_t begin = position_;
+
+    const auto read_digits = [this] {
+        if (position_ == input_.size() || !IsDigit(input_[position_])) {
+            throw ParsingError("A digit is expected"s);
+        }
+        while (position_ < input_.size() && IsDigit(input_[position_])) {
+            ++position_;
+        }
+    };
+    const auto skip = [this](char c) {
+        if (position_ < input_.size() && input_[position_] == c) {
+            ++position_;
+            return true;
+        }
+        return false;
+    };
+
+    skip('-');
+    // После 0 в JSON не могут идти другие цифры
+    if (!skip('0')) {
+        read_digits();
+    }
+
+    bool is_int = true;
+    if (skip('.')) {
+        read_digits();
+        is_int = false;
+    }
+    if (skip('e') || skip('E')) {
+        if (!skip('+')) {
+            skip('-');
+        }
+        read_digits();
+        is_int = false;
+    }
+
+    const char* first = input_.data() + begin;
+    const char* last = input_.data() + position_;
+
+    if (is_int) {
+        int value = 0;
+        if (const auto result = from_chars(first, last, value); result.ec == errc{}) {
+            handler.Value(value);
+            return;
+        }
+    }
+
+    double value = 0.0;
+    const auto result = from_chars(first, last, value);
+    if (result.ec != errc{} || result.ptr != last) {
+        throw ParsingError("Failed to convert "s + string(first, last) + " to number"s);
+    }
+    handler.Value(value);
+}
+
+}  // namespace json
@@ -0,0 +1,110 @@
+#pragma once
+#include "json.h"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace json {
+
+// Получает события разбора (SAX) в порядке следования значений в документе.
+// Ключи и строки действительны только во время вызова
+class Handler {
+public:
+    virtual void StartDict() = 0;
+    virtual void Key(std::string_view key) = 0;
+    virtual void EndDict() = 0;
+
+    virtual void StartArray() = 0;
+    virtual void EndArray() = 0;
+
+    virtual void Value(std::nullptr_t) = 0;
+    virtual void Value(bool value) = 0;
+    virtual void Value(int value) = 0;
+    virtual void Value(double value) = 0;
+    virtual void Value(std::string_view value) = 0;
+
+protected:
+    ~Handler() = default;
+};
+
+// Собирает из событий разбора дерево Node. Выбрасывает ParsingError при повторе ключа словаря
+class NodeBuilder final : public Handler {
+public:
+    void StartDict() override;
+    void Key(std::string_view key) override;
+    void EndDict() override;
+
+    void StartArray() override;
+    void EndArray() override;
+
+    void Value(std::nullptr_t) override;
+    void Value(bool value) override;
+    void Value(int value) override;
+    void Value(double value) override;
+    void Value(std::string_view value) override;
+
+    // Корневое значение собрано целиком
+    bool IsComplete() const;
+
+    // Забирает собранное значение, после чего можно собирать следующее.
+    // Выбрасывает std::logic_error, если значение ещё не собрано
+    Node Extract();
+
+private:
+    struct Frame {
+        Node node;
+        std::string key;
+    };
+
+    void Open(Node node);
+
+    void Close();
+
+    void Add(Node node);
+
+    std::vector<Frame> frames_;
+    // Корень всегда инициализирован, а признак готовности хранится отдельно: так при встраивании
+    // деструктора компилятор не видит путь чтения неинициализированного значения
+    Node root_;
+    bool is_complete_ = false;
+};
+
+// Разбирает JSON из непрерывного буфера за один проход, без потоков и посимвольного чтения.
+// Числа преобразуются std::from_chars, строки без escape-последовательностей передаются
+// как string_view прямо в буфер, строки с ними — во внутренний буфер разбора.
+// Буфер input должен жить, пока используется разборщик
+class Parser {
+public:
+    explicit Parser(std::string_view input);
+
+    // Разбирает очередное значение в дерево. Выбрасывает ParsingError, если оно некорректно
+    Node ParseNode();
+
+    // Разбирает очередное значение, передавая события обработчику
+    void Parse(Handler& handler);
+
+private:
+    // Пропускает пробельные символы и возвращает текущий символ, не извлекая его
+    char Peek();
+
+    void Expect(char c);
+
+    void ParseArray(Handler& handler);
+
+    void ParseDict(Handler& handler);
+
+    // Результат действителен до разбора следующей строки
+    std::string_view ParseString();
+
+    std::string_view ParseLiteral();
+
+    void ParseNumber(Handler& handler);
+
+    std::string_view input_;
+    size_t position_ = 0;
+    std::string unescaped_;
+};
+
+}  // namespace json
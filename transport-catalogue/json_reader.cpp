@@ -1,12 +1,15 @@
 #include "json_reader.h"
 #include "json.h"
 #include "json_builder.h"
+#include "json_writer.h"
 #include "map_renderer.h"
 #include "request_handler.h"
 #include "svg.h"
 #include "transport_catalogue.h"
 
+#include <algorithm>
 #include <sstream>
+#include <stdexcept>
 #include <unordered_map>
 #include <vector>
 #include <set>
@@ -53,14 +56,24 @@ transport_catalogue::SerializationSettings ParseSerializationSettings(const json
 
 transport_catalogue::RoutingSettings ParseRoutingSettings(const json::Document& document) {
     const auto& settings = document.GetRoot().AsDict().at("routing_settings"s).AsDict();
-    return {
+    transport_catalogue::RoutingSettings routing_settings{
         settings.at("bus_wait_time"s).AsDouble(),
         settings.at("bus_velocity"s).AsDouble(),
     };
+    if (const auto it = settings.find("engine"s); it != settings.end()) {
+        routing_settings.engine = details::ParseRouterEngine(it->second);
+    }
+    if (const auto it = settings.find("collapse_wait_edges"s); it != settings.end()) {
+        routing_settings.collapse_wait_edges = it->second.AsBool();
+    }
+    if (const auto it = settings.find("landmark_count"s); it != settings.end()) {
+        routing_settings.landmark_count = details::ParseLandmarkCount(it->second);
+    }
+    return routing_settings;
 }
 
 void ParseBaseRequests(TransportCatalogue& catalogue, const json::Document& document) {
-    const auto requests = document.GetRoot().AsDict().at("base_requests"s).AsArray();
+    const auto& requests = document.GetRoot().AsDict().at("base_requests"s).AsArray();
     for (const auto& req : requests) {
         const auto& type = req.AsDict().at("type"s).AsString();
 
@@ -81,24 +94,53 @@ void ParseBaseRequests(TransportCatalogue& catalogue, const json::Document& docu
             details::ParseInputBusRequest(catalogue, req);
         }
     }
+    catalogue.Finalize();
 }
 
-void ParseStatRequests(const RequestHandler& req_handler, const Document& document, ostream& out) {
-    Array responses;
-    for (const auto& req : document.GetRoot().AsDict().at("stat_requests"s).AsArray()) {
-        const auto type = req.AsDict().at("type"s).AsString();
-        if (type == "Stop"s) {
-            responses.push_back(details::ParseOutputStopRequest(req_handler, req));
-        } else if (type == "Bus"s) {
-            responses.push_back(details::ParseOutputBusRequest(req_handler, req));
-        } else if (type == "Map"s) {
-            responses.push_back(details::ParseOutputMapRequest(req_handler, req));
-        } else if (type == "Route"s) {
-            responses.push_back(details::ParseOutputRouteRequest(req_handler, req));
+Document ParseBaseDocument(TransportCatalogue& catalogue, string_view input) {
+    details::BaseDocumentHandler handler(catalogue);
+    Parser(input).Parse(handler);
+    return handler.Finish();
+}
+
+void ParseStatRequests(const RequestHandler& req_handler, const Document& document, ostream& out,
+                       size_t thread_count) {
+    const auto& requests = document.GetRoot().AsDict().at("stat_requests"s).AsArray();
+
+    concurrency::ThreadPool thread_pool(thread_count);
+
+    // Справочник, визуализатор и маршрутизатор после загрузки только читаются, поэтому запросы порции
+    // можно обрабатывать одновременно, каждый в свой буфер. Буферы переиспользуются между порциями,
+    // а маршруты порции освобождаются после её вывода, поэтому память не растёт с числом запросов
+    const size_t chunk_size = details::RESPONSE_CHUNK_SIZE * thread_pool.GetThreadCount();
+    vector<string> responses(min(chunk_size, requests.size()));
+    vector<char> has_responses(responses.size(), false);
+
+    string output;
+    Writer writer(output);
+    writer.StartArray();
+    for (size_t chunk_begin = 0; chunk_begin < requests.size(); chunk_begin += chunk_size) {
+        const size_t chunk_end = min(chunk_begin + chunk_size, requests.size());
+        const auto route_results = details::PlanRouteRequests(req_handler, requests, chunk_begin, chunk_end,
+                                                              thread_pool);
+
+        thread_pool.ParallelFor(chunk_end - chunk_begin, [&](size_t offset) {
+            responses[offset].clear();
+            Writer response_writer(responses[offset], writer.GetItemIndent());
+            has_responses[offset] = details::ParseOutputRequest(req_handler, requests[chunk_begin + offset],
+                                                                route_results[offset], response_writer);
+        });
+
+        for (size_t offset = 0; offset < chunk_end - chunk_begin; ++offset) {
+            if (has_responses[offset]) {
+                writer.RawValue(responses[offset]);
+            }
         }
+        out << output;
+        output.clear();
     }
-
-    Print(json::Document{{responses}}, out);
+    writer.EndArray();
+    out << output;
 }
 
 namespace details {
@@ -127,6 +169,32 @@ svg::Color ParseColor(const json::Node& color) {
     return color.AsString();
 }
 
+RouterEngine ParseRouterEngine(const json::Node& engine) {
+    const auto& name = engine.AsString();
+    if (name == "all_pairs"s) {
+        return RouterEngine::AllPairs;
+    } else if (name == "dijkstra"s) {
+        return RouterEngine::Dijkstra;
+    } else if (name == "contraction_hierarchies"s) {
+        return RouterEngine::ContractionHierarchies;
+    } else if (name == "raptor"s) {
+        return RouterEngine::Raptor;
+    } else if (name == "astar"s) {
+        return RouterEngine::AStar;
+    } else if (name == "bidirectional_dijkstra"s) {
+        return RouterEngine::BidirectionalDijkstra;
+    }
+    throw invalid_argument("Unknown router engine '"s + name + "'"s);
+}
+
+size_t ParseLandmarkCount(const json::Node& landmark_count) {
+    const int count = landmark_count.AsInt();
+    if (count < 0 || static_cast<size_t>(count) > RoutingSettings::MAX_LANDMARK_COUNT) {
+        throw invalid_argument("landmark_count should be from 0 to "s + to_string(RoutingSettings::MAX_LANDMARK_COUNT));
+    }
+    return static_cast<size_t>(count);
+}
+
 void ParseInputDistanceRequest(TransportCatalogue& catalogue, const Node& request) {
     const auto from = request.AsDict().at("name"s).AsString();
     for (const auto& [to, distance] : request.AsDict().at("road_distances"s).AsDict()) {
@@ -138,7 +206,7 @@ void ParseInputDistanceRequest(TransportCatalogue& catalogue, const Node& reques
 }
 
 void ParseInputBusRequest(TransportCatalogue& catalogue, const Node& request) {
-    auto dict = request.AsDict();
+    const auto& dict = request.AsDict();
     bool is_roundtrip = dict.at("is_roundtrip"s).AsBool();
 
     vector<StopPtr> stops;
@@ -149,114 +217,452 @@ void ParseInputBusRequest(TransportCatalogue& catalogue, const Node& request) {
     catalogue.AddBus({dict.at("name"s).AsString(), is_roundtrip, move(stops)});
 }
 
-Node ParseOutputStopRequest(const RequestHandler& req_handler, const Node& req) {
-    if (const auto* buses = req_handler.GetBusesByStop(req.AsDict().at("name"s).AsString())) {
-        set<string> bus_names;
-        for (const auto* bus : *buses) {
-            bus_names.insert(bus->name);
+BaseDocumentHandler::BaseDocumentHandler(TransportCatalogue& catalogue) :
+    catalogue_(catalogue) {
+}
+
+Document BaseDocumentHandler::Finish() {
+    for (const auto& [from, to, distance] : pending_distances_) {
+        catalogue_.SetDistance(catalogue_.FindStop(from), catalogue_.FindStop(to), distance);
+    }
+    pending_distances_.clear();
+
+    FlushPendingBuses();
+    // Остановки оставшихся автобусов так и не были объявлены: FindStop выбросит исключение
+    for (const auto& bus : pending_buses_) {
+        AddBus(bus);
+    }
+    pending_buses_.clear();
+    catalogue_.Finalize();
+
+    return Document{Node{move(sections_)}};
+}
+
+template <typename Event>
+bool BaseDocumentHandler::ForwardToSection(Event event) {
+    if (!is_in_section_) {
+        return false;
+    }
+
+    event(section_builder_);
+    if (section_builder_.IsComplete()) {
+        if (!sections_.try_emplace(key_, section_builder_.Extract()).second) {
+            throw ParsingError("Duplicate key '"s + key_ + "' have been found");
         }
-        return Builder{}
-            .StartDict()
-                .Key("request_id"s).Value(req.AsDict().at("id"s).AsInt())
-                .Key("buses"s).Value(Array{bus_names.begin(), bus_names.end()})
-            .EndDict()
-            .Build();
-    } else {
-        return Builder{}
-            .StartDict()
-                .Key("request_id"s).Value(req.AsDict().at("id"s).AsInt())
-                .Key("error_message"s).Value("not found"s)
-            .EndDict()
-            .Build();
-    }
-}
-
-Node ParseOutputBusRequest(const RequestHandler& req_handler, const Node& req) {
-    if (const auto bus_stat = req_handler.GetBusStat(req.AsDict().at("name"s).AsString())) {
-        return Builder{}
-            .StartDict()
-                .Key("request_id"s).Value(req.AsDict().at("id"s).AsInt())
-                .Key("curvature"s).Value(bus_stat->curvature)
-                .Key("route_length"s).Value(bus_stat->route_length)
-                .Key("stop_count"s).Value(static_cast<int>(bus_stat->stops_amount))
-                .Key("unique_stop_count"s).Value(static_cast<int>(bus_stat->unique_stops_amount))
-            .EndDict()
-            .Build();
-    } else {
-        return Builder{}
-            .StartDict()
-                .Key("request_id"s).Value(req.AsDict().at("id"s).AsInt())
-                .Key("error_message"s).Value("not found"s)
-            .EndDict()
-            .Build();
+        is_in_section_ = false;
+    }
+    return true;
+}
+
+void BaseDocumentHandler::StartDict() {
+    if (ForwardToSection([](NodeBuilder& builder) { builder.StartDict(); })) {
+        return;
+    }
+
+    ++depth_;
+    if (depth_ == REQUESTS_DEPTH) {
+        throw logic_error("Not an array"s);
+    } else if (depth_ == REQUEST_DEPTH) {
+        request_ = {};
+    } else if (depth_ == FIELD_DEPTH) {
+        field_ = Field::Other;
+        if (key_ == "road_distances"sv) {
+            field_ = Field::RoadDistances;
+            request_.road_distances.emplace();
+        }
+    }
+}
+
+void BaseDocumentHandler::Key(string_view key) {
+    if (ForwardToSection([key](NodeBuilder& builder) { builder.Key(key); })) {
+        return;
+    }
+
+    if (depth_ == ROOT_DEPTH) {
+        key_ = key;
+        is_in_section_ = key != "base_requests"sv;
+    } else if (depth_ == REQUEST_DEPTH) {
+        key_ = key;
+    } else if (depth_ == FIELD_DEPTH && field_ == Field::RoadDistances) {
+        distance_key_ = key;
+    }
+}
+
+void BaseDocumentHandler::EndDict() {
+    if (ForwardToSection([](NodeBuilder& builder) { builder.EndDict(); })) {
+        return;
+    }
+
+    if (depth_ == REQUEST_DEPTH) {
+        AddRequest();
+    }
+    --depth_;
+}
+
+void BaseDocumentHandler::StartArray() {
+    if (ForwardToSection([](NodeBuilder& builder) { builder.StartArray(); })) {
+        return;
+    }
+
+    ++depth_;
+    if (depth_ == ROOT_DEPTH || depth_ == REQUEST_DEPTH) {
+        throw logic_error("Not a dict"s);
+    } else if (depth_ == FIELD_DEPTH) {
+        field_ = Field::Other;
+        if (key_ == "stops"sv) {
+            field_ = Field::Stops;
+            request_.stops.emplace();
+        }
+    }
+}
+
+void BaseDocumentHandler::EndArray() {
+    if (ForwardToSection([](NodeBuilder& builder) { builder.EndArray(); })) {
+        return;
+    }
+
+    --depth_;
+}
+
+void BaseDocumentHandler::Value(nullptr_t) {
+    if (!ForwardToSection([](NodeBuilder& builder) { builder.Value(nullptr); })) {
+        OnScalar(Node{nullptr});
+    }
+}
+
+void BaseDocumentHandler::Value(bool value) {
+    if (!ForwardToSection([value](NodeBuilder& builder) { builder.Value(value); })) {
+        OnScalar(Node{value});
+    }
+}
+
+void BaseDocumentHandler::Value(int value) {
+    if (!ForwardToSection([value](NodeBuilder& builder) { builder.Value(value); })) {
+        OnScalar(Node{value});
+    }
+}
+
+void BaseDocumentHandler::Value(double value) {
+    if (!ForwardToSection([value](NodeBuilder& builder) { builder.Value(value); })) {
+        OnScalar(Node{value});
+    }
+}
+
+void BaseDocumentHandler::Value(string_view value) {
+    if (!ForwardToSection([value](NodeBuilder& builder) { builder.Value(value); })) {
+        OnScalar(Node{string(value)});
+    }
+}
+
+// Значения проверяются теми же методами Node, что и при разборе готового документа
+void BaseDocumentHandler::OnScalar(const Node& value) {
+    if (depth_ < REQUEST_DEPTH) {
+        throw logic_error(depth_ == ROOT_DEPTH ? "Not an array"s : "Not a dict"s);
+    }
+
+    if (depth_ == REQUEST_DEPTH) {
+        if (key_ == "type"sv) {
+            request_.type = value.AsString();
+        } else if (key_ == "name"sv) {
+            request_.name = value.AsString();
+        } else if (key_ == "latitude"sv) {
+            request_.latitude = value.AsDouble();
+        } else if (key_ == "longitude"sv) {
+            request_.longitude = value.AsDouble();
+        } else if (key_ == "is_roundtrip"sv) {
+            request_.is_roundtrip = value.AsBool();
+        }
+    } else if (depth_ == FIELD_DEPTH) {
+        if (field_ == Field::RoadDistances) {
+            request_.road_distances->emplace_back(distance_key_, value.AsDouble());
+        } else if (field_ == Field::Stops) {
+            request_.stops->push_back(value.AsString());
+        }
+    }
+}
+
+void BaseDocumentHandler::AddRequest() {
+    const auto& type = request_.type.value();
+    if (type == "Stop"s) {
+        AddStop();
+    } else if (type == "Bus"s) {
+        pending_buses_.push_back({move(request_.name.value()), request_.is_roundtrip.value(),
+                                  move(request_.stops.value())});
+        FlushPendingBuses();
+    }
+}
+
+void BaseDocumentHandler::AddStop() {
+    auto& name = request_.name.value();
+    catalogue_.AddStop({name, {request_.latitude.value(), request_.longitude.value()}});
+
+    const auto& from = catalogue_.FindStop(name);
+    for (auto& [to, distance] : request_.road_distances.value()) {
+        if (catalogue_.HasStop(to)) {
+            catalogue_.SetDistance(from, catalogue_.FindStop(to), distance);
+        } else {
+            pending_distances_.push_back({name, move(to), distance});
+        }
+    }
+
+    FlushPendingBuses();
+}
+
+void BaseDocumentHandler::AddBus(const PendingBus& bus) {
+    vector<StopPtr> stops;
+    stops.reserve(bus.stops.size());
+    for (const auto& stop_name : bus.stops) {
+        stops.push_back(&catalogue_.FindStop(stop_name));
+    }
+    catalogue_.AddBus({bus.name, bus.is_roundtrip, move(stops)});
+}
+
+void BaseDocumentHandler::FlushPendingBuses() {
+    while (!pending_buses_.empty()) {
+        auto& bus = pending_buses_.front();
+        while (bus.known_stop_count < bus.stops.size() && catalogue_.HasStop(bus.stops[bus.known_stop_count])) {
+            ++bus.known_stop_count;
+        }
+        if (bus.known_stop_count < bus.stops.size()) {
+            return;
+        }
+        AddBus(bus);
+        pending_buses_.pop_front();
     }
 }
 
-Node ParseOutputMapRequest(const RequestHandler& req_handler, const Node& req) {
+void WriteNotFound(const Node& req, Writer& writer) {
+    writer.StartDict()
+        .Key("error_message"sv).Value("not found"sv)
+        .Key("request_id"sv).Value(req.AsDict().at("id"s).AsInt())
+    .EndDict();
+}
+
+void ParseOutputStopRequest(const RequestHandler& req_handler, const Node& req, Writer& writer) {
+    const auto* buses = req_handler.GetBusesByStop(req.AsDict().at("name"s).AsString());
+    if (!buses) {
+        WriteNotFound(req, writer);
+        return;
+    }
+
+    // Справочник хранит автобусы остановки уже упорядоченными по названиям и без повторов
+    writer.StartDict().Key("buses"sv).StartArray();
+    for (const BusId bus : *buses) {
+        writer.Value(req_handler.GetBus(bus).name);
+    }
+    writer.EndArray()
+        .Key("request_id"sv).Value(req.AsDict().at("id"s).AsInt())
+    .EndDict();
+}
+
+void ParseOutputBusRequest(const RequestHandler& req_handler, const Node& req, Writer& writer) {
+    const auto bus_stat = req_handler.GetBusStat(req.AsDict().at("name"s).AsString());
+    if (!bus_stat) {
+        WriteNotFound(req, writer);
+        return;
+    }
+
+    writer.StartDict()
+        .Key("curvature"sv).Value(bus_stat->curvature)
+        .Key("request_id"sv).Value(req.AsDict().at("id"s).AsInt())
+        .Key("route_length"sv).Value(bus_stat->route_length)
+        .Key("stop_count"sv).Value(static_cast<int>(bus_stat->stops_amount))
+        .Key("unique_stop_count"sv).Value(static_cast<int>(bus_stat->unique_stops_amount))
+    .EndDict();
+}
+
+void ParseOutputMapRequest(const RequestHandler& req_handler, const Node& req, Writer& writer) {
     ostringstream out;
     req_handler.RenderMap().Render(out);
 
-    return Builder{}
-        .StartDict()
-            .Key("request_id"s).Value(req.AsDict().at("id"s).AsInt())
-            .Key("map"s).Value(out.str())
-        .EndDict()
-        .Build();
-}
-
-Node ParseOutputRouteRequest(const RequestHandler& req_handler, const Node& req) {
-    const auto from = req.AsDict().at("from"s).AsString();
-    const auto to = req.AsDict().at("to"s).AsString();
-
-    if (auto result = req_handler.BuildRoute(from, to)) {
-        const auto [total_time, route_items] = *result;
-
-        Builder itemsBuilder;
-        auto arrayBuilder = itemsBuilder.StartArray();
-        for (const auto& item : route_items) {
-            if (item.type == RouteItemType::Wait) {
-                arrayBuilder.Value(Builder{}
-                    .StartDict()
-                        .Key("type"s).Value("Wait"s)
-                        .Key("stop_name"s).Value(item.stop_name)
-                        .Key("time"s).Value(item.time)
-                    .EndDict()
-                    .Build()
-                    .AsDict()
-                );
+    writer.StartDict()
+        .Key("map"sv).Value(out.str())
+        .Key("request_id"sv).Value(req.AsDict().at("id"s).AsInt())
+    .EndDict();
+}
+
+bool ParseOutputRequest(const RequestHandler& req_handler, const Node& req,
+                        const optional<TransportRouter::RouteResultPtr>& route_result, Writer& writer) {
+    const auto& type = req.AsDict().at("type"s).AsString();
+    if (type == "Stop"s) {
+        ParseOutputStopRequest(req_handler, req, writer);
+    } else if (type == "Bus"s) {
+        ParseOutputBusRequest(req_handler, req, writer);
+    } else if (type == "Map"s) {
+        ParseOutputMapRequest(req_handler, req, writer);
+    } else if (type == "Route"s) {
+        if (route_result) {
+            WriteRouteResponse(req, *route_result, writer);
+        } else {
+            ParseOutputRouteRequest(req_handler, req, writer);
+        }
+    } else if (type == "RouteMatrix"s) {
+        ParseOutputRouteMatrixRequest(req_handler, req, writer);
+    } else if (type == "Reachable"s) {
+        ParseOutputReachableRequest(req_handler, req, writer);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void ParseOutputRouteRequest(const RequestHandler& req_handler, const Node& req, Writer& writer) {
+    const auto& from = req.AsDict().at("from"s).AsString();
+    const auto& to = req.AsDict().at("to"s).AsString();
+
+    WriteRouteResponse(req, req_handler.BuildRoute(from, to), writer);
+}
+
+void WriteRouteResponse(const Node& req, const TransportRouter::RouteResultPtr& result, Writer& writer) {
+    if (!result) {
+        WriteNotFound(req, writer);
+        return;
+    }
+
+    const auto& [total_time, route_items] = *result;
+
+    writer.StartDict().Key("items"sv).StartArray();
+    for (const auto& item : route_items) {
+        if (item.type == RouteItemType::Wait) {
+            writer.StartDict()
+                .Key("stop_name"sv).Value(item.stop->name)
+                .Key("time"sv).Value(item.time)
+                .Key("type"sv).Value("Wait"sv)
+            .EndDict();
+        } else {
+            writer.StartDict()
+                .Key("bus"sv).Value(item.bus->name)
+                .Key("span_count"sv).Value(item.span_count)
+                .Key("time"sv).Value(item.time)
+                .Key("type"sv).Value("Bus"sv)
+            .EndDict();
+        }
+    }
+    writer.EndArray()
+        .Key("request_id"sv).Value(req.AsDict().at("id"s).AsInt())
+        .Key("total_time"sv).Value(total_time)
+    .EndDict();
+}
+
+vector<optional<TransportRouter::RouteResultPtr>> PlanRouteRequests(const RequestHandler& req_handler,
+                                                                    const Array& requests,
+                                                                    size_t begin, size_t end,
+                                                                    concurrency::ThreadPool& thread_pool) {
+    struct RouteGroup {
+        string_view from;
+        vector<string_view> to;
+        vector<size_t> request_indices;
+    };
+
+    // Группы нумеруются в порядке первого появления остановки from
+    vector<RouteGroup> groups;
+    unordered_map<string_view, size_t> group_by_stop;
+    for (size_t index = begin; index < end; ++index) {
+        const auto& dict = requests[index].AsDict();
+        if (dict.at("type"s).AsString() != "Route"s) {
+            continue;
+        }
+
+        const string_view from = dict.at("from"s).AsString();
+        const auto [it, is_inserted] = group_by_stop.emplace(from, groups.size());
+        if (is_inserted) {
+            groups.push_back({from, {}, {}});
+        }
+        auto& group = groups[it->second];
+        group.to.push_back(dict.at("to"s).AsString());
+        group.request_indices.push_back(index - begin);
+    }
+
+    vector<optional<TransportRouter::RouteResultPtr>> results(end - begin);
+    thread_pool.ParallelFor(groups.size(), [&req_handler, &groups, &results](size_t group_index) {
+        const auto& group = groups[group_index];
+        auto routes = req_handler.BuildRoutes(group.from, group.to);
+        for (size_t i = 0; i < routes.size(); ++i) {
+            results[group.request_indices[i]] = move(routes[i]);
+        }
+    });
+
+    return results;
+}
+
+// Ответ содержит построчную матрицу total_times (null, если маршрута нет)
+// и, если в запросе задано "span_counts": true, такую же матрицу чисел перегонов
+void ParseOutputRouteMatrixRequest(const RequestHandler& req_handler, const Node& req, Writer& writer) {
+    const auto& dict = req.AsDict();
+
+    vector<string_view> from;
+    for (const auto& name : dict.at("from"s).AsArray()) {
+        from.push_back(name.AsString());
+    }
+    vector<string_view> to;
+    for (const auto& name : dict.at("to"s).AsArray()) {
+        to.push_back(name.AsString());
+    }
+    const auto span_counts_it = dict.find("span_counts"s);
+    const bool with_span_counts = span_counts_it != dict.end() && span_counts_it->second.AsBool();
+
+    const auto matrix = req_handler.BuildRouteMatrix(from, to, with_span_counts);
+    if (!matrix) {
+        WriteNotFound(req, writer);
+        return;
+    }
+
+    writer.StartDict().Key("request_id"sv).Value(dict.at("id"s).AsInt());
+
+    if (with_span_counts) {
+        writer.Key("span_counts"sv).StartArray();
+        for (size_t row = 0; row < from.size(); ++row) {
+            writer.StartArray();
+            for (size_t column = 0; column < to.size(); ++column) {
+                writer.Value(matrix->span_counts[row * matrix->column_count + column]);
+            }
+            writer.EndArray();
+        }
+        writer.EndArray();
+    }
+
+    writer.Key("total_times"sv).StartArray();
+    for (size_t row = 0; row < from.size(); ++row) {
+        writer.StartArray();
+        for (size_t column = 0; column < to.size(); ++column) {
+            if (const auto& total_time = matrix->total_times[row * matrix->column_count + column]) {
+                writer.Value(*total_time);
             } else {
-                arrayBuilder.Value(Builder{}
-                    .StartDict()
-                        .Key("type"s).Value("Bus"s)
-                        .Key("bus"s).Value(item.bus_name)
-                        .Key("span_count"s).Value(item.span_count)
-                        .Key("time"s).Value(item.time)
-                    .EndDict()
-                    .Build()
-                    .AsDict()
-                );
+                writer.Value(nullptr);
             }
         }
-        arrayBuilder.EndArray();
-
-        return Builder{}
-            .StartDict()
-                .Key("request_id"s).Value(req.AsDict().at("id"s).AsInt())
-                .Key("total_time"s).Value(total_time)
-                .Key("items"s).Value(itemsBuilder.Build().AsArray())
-            .EndDict()
-            .Build();
-    } else {
-        return Builder{}
-            .StartDict()
-                .Key("request_id"s).Value(req.AsDict().at("id"s).AsInt())
-                .Key("error_message"s).Value("not found"s)
-            .EndDict()
-            .Build();
+        writer.EndArray();
+    }
+    writer.EndArray();
+
+    writer.EndDict();
+}
+
+// Ответ содержит параллельные массивы stop_names и times по возрастанию времени в пути,
+// включая саму остановку from с нулевым временем
+void ParseOutputReachableRequest(const RequestHandler& req_handler, const Node& req, Writer& writer) {
+    const auto& dict = req.AsDict();
+
+    const auto reachable_stops = req_handler.FindReachableStops(dict.at("from"s).AsString(),
+                                                                dict.at("max_time"s).AsDouble());
+    if (!reachable_stops) {
+        WriteNotFound(req, writer);
+        return;
+    }
+
+    writer.StartDict()
+        .Key("request_id"sv).Value(dict.at("id"s).AsInt())
+        .Key("stop_names"sv).StartArray();
+    for (const auto& reachable_stop : *reachable_stops) {
+        writer.Value(reachable_stop.stop->name);
     }
+    writer.EndArray().Key("times"sv).StartArray();
+    for (const auto& reachable_stop : *reachable_stops) {
+        writer.Value(reachable_stop.time);
+    }
+    writer.EndArray().EndDict();
 }
 
 } // namespace details
 
 } // namespace transport_catalogue
-
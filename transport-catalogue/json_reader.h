@@ -3,9 +3,17 @@
 #include "map_renderer.h"
 #include "request_handler.h"
 #include "json.h"
+#include "json_parser.h"
+#include "json_writer.h"
 #include "transport_router.h"
+#include "thread_pool.h"
 
+#include <deque>
 #include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
 #include <unordered_set>
 
 /*
@@ -23,25 +31,152 @@ transport_catalogue::RoutingSettings ParseRoutingSettings(const json::Document&
 
 void ParseBaseRequests(TransportCatalogue& catalogue, const json::Document& document);
 
-void ParseStatRequests(const RequestHandler& request_handler, const json::Document& document, std::ostream& out);
+// Разбирает документ make_base потоково: запросы base_requests добавляются в справочник по мере разбора,
+// без построения дерева. Откладываются только расстояния до ещё не объявленных остановок и автобусы,
+// начиная с первого, проходящего через такие остановки (чтобы автобусы добавлялись в порядке запросов).
+// Возвращает документ с остальными разделами
+json::Document ParseBaseDocument(TransportCatalogue& catalogue, std::string_view input);
+
+// Запросы обрабатываются параллельно в thread_count потоках порциями по RESPONSE_CHUNK_SIZE на поток,
+// и каждая готовая порция сразу выводится в порядке запросов. Запросы Route порции с общей
+// остановкой from обрабатываются вместе
+void ParseStatRequests(const RequestHandler& request_handler, const json::Document& document, std::ostream& out,
+                       size_t thread_count = 1);
 
 namespace details {
 
+inline constexpr size_t RESPONSE_CHUNK_SIZE = 1024;
+
 svg::Point ParsePoint(const json::Array& point);
 
 svg::Color ParseColor(const json::Node& color);
 
+RouterEngine ParseRouterEngine(const json::Node& engine);
+
+// Выбрасывает std::invalid_argument, если число отрицательное или больше RoutingSettings::MAX_LANDMARK_COUNT
+size_t ParseLandmarkCount(const json::Node& landmark_count);
+
 void ParseInputDistanceRequest(TransportCatalogue& catalogue, const json::Node& request);
 
 void ParseInputBusRequest(TransportCatalogue& catalogue, const json::Node& request);
 
-json::Node ParseOutputStopRequest(const RequestHandler& request_handler, const json::Node& request);
+// Принимает события разбора документа make_base. Разделы настроек собираются в дерево,
+// а каждый запрос base_requests передаётся в справочник сразу после его разбора
+class BaseDocumentHandler final : public json::Handler {
+public:
+    explicit BaseDocumentHandler(TransportCatalogue& catalogue);
+
+    // Добавляет отложенные расстояния и автобусы и возвращает разделы, кроме base_requests
+    json::Document Finish();
+
+    void StartDict() override;
+    void Key(std::string_view key) override;
+    void EndDict() override;
+
+    void StartArray() override;
+    void EndArray() override;
+
+    void Value(std::nullptr_t) override;
+    void Value(bool value) override;
+    void Value(int value) override;
+    void Value(double value) override;
+    void Value(std::string_view value) override;
+
+private:
+    // Глубина корневого словаря, массива base_requests, запроса и значений его полей
+    static constexpr size_t ROOT_DEPTH = 1;
+    static constexpr size_t REQUESTS_DEPTH = 2;
+    static constexpr size_t REQUEST_DEPTH = 3;
+    static constexpr size_t FIELD_DEPTH = 4;
+
+    enum class Field {
+        Other,
+        RoadDistances,
+        Stops
+    };
+
+    struct Request {
+        std::optional<std::string> type;
+        std::optional<std::string> name;
+        std::optional<double> latitude;
+        std::optional<double> longitude;
+        std::optional<bool> is_roundtrip;
+        std::optional<std::vector<std::pair<std::string, double>>> road_distances;
+        std::optional<std::vector<std::string>> stops;
+    };
+
+    struct PendingDistance {
+        std::string from;
+        std::string to;
+        double distance;
+    };
+
+    struct PendingBus {
+        std::string name;
+        bool is_roundtrip;
+        std::vector<std::string> stops;
+        // Число первых остановок, уже найденных в справочнике
+        size_t known_stop_count = 0;
+    };
+
+    // Передаёт событие сборщику раздела, если разбирается раздел настроек
+    template <typename Event>
+    bool ForwardToSection(Event event);
+
+    void OnScalar(const json::Node& value);
+
+    void AddRequest();
+
+    void AddStop();
+
+    void AddBus(const PendingBus& bus);
+
+    // Добавляет автобусы из начала очереди, все остановки которых уже известны
+    void FlushPendingBuses();
+
+    TransportCatalogue& catalogue_;
+
+    size_t depth_ = 0;
+    bool is_in_section_ = false;
+    std::string key_;
+    std::string distance_key_;
+    Field field_ = Field::Other;
+
+    json::NodeBuilder section_builder_;
+    json::Dict sections_;
+
+    Request request_;
+    std::vector<PendingDistance> pending_distances_;
+    std::deque<PendingBus> pending_buses_;
+};
+
+void ParseOutputStopRequest(const RequestHandler& request_handler, const json::Node& request, json::Writer& writer);
+
+void ParseOutputBusRequest(const RequestHandler& request_handler, const json::Node& request, json::Writer& writer);
+
+void ParseOutputMapRequest(const RequestHandler& req_handler, const json::Node& req, json::Writer& writer);
+
+void ParseOutputRouteRequest(const RequestHandler& req_handler, const json::Node& req, json::Writer& writer);
+
+void WriteRouteResponse(const json::Node& req, const TransportRouter::RouteResultPtr& result, json::Writer& writer);
+
+// Заранее строит маршруты для запросов Route из [begin, end), группируя их по остановке from.
+// Элемент результата i соответствует запросу begin + i и пуст для запросов других типов
+std::vector<std::optional<TransportRouter::RouteResultPtr>> PlanRouteRequests(const RequestHandler& req_handler,
+                                                                              const json::Array& requests,
+                                                                              size_t begin, size_t end,
+                                                                              concurrency::ThreadPool& thread_pool);
+
+void ParseOutputRouteMatrixRequest(const RequestHandler& req_handler, const json::Node& req, json::Writer& writer);
 
-json::Node ParseOutputBusRequest(const RequestHandler& request_handler, const json::Node& request);
+void ParseOutputReachableRequest(const RequestHandler& req_handler, const json::Node& req, json::Writer& writer);
 
-json::Node ParseOutputMapRequest(const RequestHandler& req_handler, const json::Node& req);
+void WriteNotFound(const json::Node& req, json::Writer& writer);
 
-json::Node ParseOutputRouteRequest(const RequestHandler& req_handler, const json::Node& req);
+// Пишет ответ на запрос любого типа. Для Route используется заранее построенный маршрут, если он передан.
+// Возвращает false для запросов неизвестного типа, на которые ответа нет
+bool ParseOutputRequest(const RequestHandler& req_handler, const json::Node& req,
+                        const std::optional<TransportRouter::RouteResultPtr>& route_result, json::Writer& writer);
 
 } // namespace details
 
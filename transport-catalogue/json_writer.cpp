@@ -0,0 +1,183 @@
+#include "json_writer.h"
+
+#include <charconv>
+#include <stdexcept>
+
+namespace json {
+
+using namespace std;
+
+Writer::Writer(string& output, int indent)
+    : output_(output)
+    , indent_(indent) {
+}
+
+Writer& Writer::Key(string_view key) {
+    if (depth_ == 0 || !contexts_[depth_ - 1].is_dict) {
+        throw logic_error("There is not dict for key"s);
+    }
+
+    auto& context = contexts_[depth_ - 1];
+    if (context.has_key) {
+        throw logic_error("Key is already set"s);
+    }
+    if (!context.is_empty) {
+        output_ += ",\n"sv;
+    }
+    context.is_empty = false;
+    context.has_key = true;
+
+    WriteIndent(GetItemIndent());
+    WriteString(key);
+    output_ += ": "sv;
+    return *this;
+}
+
+Writer& Writer::Value(nullptr_t) {
+    BeginValue();
+    output_ += "null"sv;
+    return *this;
+}
+
+Writer& Writer::Value(bool value) {
+    BeginValue();
+    output_ += value ? "true"sv : "false"sv;
+    return *this;
+}
+
+Writer& Writer::Value(int value) {
+    BeginValue();
+    char buffer[16];
+    const auto result = to_chars(begin(buffer), end(buffer), value);
+    output_.append(buffer, result.ptr);
+    return *this;
+}
+
+// Формат совпадает с выводом double в поток с точностью по умолчанию, как в Print
+Writer& Writer::Value(double value) {
+    BeginValue();
+    char buffer[32];
+    const auto result = to_chars(begin(buffer), end(buffer), value, chars_format::general, 6);
+    output_.append(buffer, result.ptr);
+    return *this;
+}
+
+Writer& Writer::Value(string_view value) {
+    BeginValue();
+    WriteString(value);
+    return *this;
+}
+
+Writer& Writer::Value(const char* value) {
+    return Value(string_view(value));
+}
+
+Writer& Writer::RawValue(string_view value) {
+    BeginValue();
+    output_ += value;
+    return *this;
+}
+
+Writer& Writer::StartDict() {
+    BeginValue();
+    if (depth_ == MAX_DEPTH) {
+        throw logic_error("Document is too deep"s);
+    }
+    contexts_[depth_++] = {true, true, false};
+    output_ += "{\n"sv;
+    return *this;
+}
+
+Writer& Writer::EndDict() {
+    Close(true, '}');
+    return *this;
+}
+
+Writer& Writer::StartArray() {
+    BeginValue();
+    if (depth_ == MAX_DEPTH) {
+        throw logic_error("Document is too deep"s);
+    }
+    contexts_[depth_++] = {false, true, false};
+    output_ += "[\n"sv;
+    return *this;
+}
+
+Writer& Writer::EndArray() {
+    Close(false, ']');
+    return *this;
+}
+
+int Writer::GetItemIndent() const {
+    return indent_ + INDENT_STEP * static_cast<int>(depth_);
+}
+
+// Элементы массива разделяются так же, как в Print: запятая, перевод строки и отступ
+void Writer::BeginValue() {
+    if (depth_ == 0) {
+        if (is_complete_) {
+            throw logic_error("Document is complete"s);
+        }
+        is_complete_ = true;
+        return;
+    }
+
+    auto& context = contexts_[depth_ - 1];
+    if (context.is_dict) {
+        if (!context.has_key) {
+            throw logic_error("Key is not set"s);
+        }
+        context.has_key = false;
+        return;
+    }
+
+    if (!context.is_empty) {
+        output_ += ",\n"sv;
+    }
+    context.is_empty = false;
+    WriteIndent(GetItemIndent());
+}
+
+// Пустой контейнер выводится, как в Print, с пустой строкой между скобками
+void Writer::Close(bool is_dict, char bracket) {
+    if (depth_ == 0 || contexts_[depth_ - 1].is_dict != is_dict) {
+        throw logic_error(is_dict ? "There is not dict to end"s : "There is not array to end"s);
+    }
+    if (contexts_[depth_ - 1].has_key) {
+        throw logic_error("Value for key is not set"s);
+    }
+
+    --depth_;
+    output_ += '\n';
+    WriteIndent(GetItemIndent());
+    output_ += bracket;
+}
+
+void Writer::WriteIndent(int indent) {
+    output_.append(static_cast<size_t>(indent), ' ');
+}
+
+void Writer::WriteString(string_view value) {
+    output_ += '"';
+    for (const char c : value) {
+        switch (c) {
+            case '\r':
+                output_ += "\\r"sv;
+                break;
+            case '\n':
+                output_ += "\\n"sv;
+                break;
+            case '"':
+                [[fallthrough]];
+            case '\\':
+                output_ += '\\';
+                [[fallthrough]];
+            default:
+                output_ += c;
+                break;
+        }
+    }
+    output_ += '"';
+}
+
+}  // namespace json
@@ -0,0 +1,66 @@
+#pragma once
+#include "json.h"
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace json {
+
+// Пишет JSON прямо в строку в том же формате, что и Print, не строя дерево Node.
+// Ключи словаря нужно передавать в порядке возрастания: так их упорядочивает Dict при выводе через Print.
+// indent — отступ строки, на которой начинается значение, если оно вкладывается в чужой вывод.
+// Как и Builder, выбрасывает std::logic_error при нарушении структуры документа
+class Writer {
+public:
+    explicit Writer(std::string& output, int indent = 0);
+
+    Writer& Key(std::string_view key);
+
+    Writer& Value(std::nullptr_t);
+    Writer& Value(bool value);
+    Writer& Value(int value);
+    Writer& Value(double value);
+    Writer& Value(std::string_view value);
+    Writer& Value(const char* value);
+
+    // Вставляет значение, уже записанное другим Writer с отступом GetItemIndent()
+    Writer& RawValue(std::string_view value);
+
+    Writer& StartDict();
+    Writer& EndDict();
+
+    Writer& StartArray();
+    Writer& EndArray();
+
+    // Отступ, с которого начинаются элементы текущего массива или словаря
+    int GetItemIndent() const;
+
+private:
+    static constexpr int INDENT_STEP = 4;
+    static constexpr size_t MAX_DEPTH = 64;
+
+    struct Context {
+        bool is_dict = false;
+        bool is_empty = true;
+        bool has_key = false;
+    };
+
+    void BeginValue();
+
+    void Close(bool is_dict, char bracket);
+
+    void WriteIndent(int indent);
+
+    void WriteString(std::string_view value);
+
+    std::string& output_;
+    const int indent_;
+
+    std::array<Context, MAX_DEPTH> contexts_;
+    size_t depth_ = 0;
+    bool is_complete_ = false;
+};
+
+}  // namespace json
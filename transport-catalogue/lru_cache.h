@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+namespace cache {
+
+struct CacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+};
+
+// Потокобезопасный кеш ограниченного размера с вытеснением давно не использованных значений.
+// Кеш нулевой ёмкости ничего не хранит, но продолжает считать промахи.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache {
+public:
+    explicit LruCache(size_t capacity)
+        : capacity_(capacity) {
+    }
+
+    std::optional<Value> Get(const Key& key) {
+        {
+            std::lock_guard guard(mutex_);
+            if (const auto it = index_.find(key); it != index_.end()) {
+                entries_.splice(entries_.begin(), entries_, it->second);
+                ++hits_;
+                return it->second->second;
+            }
+        }
+        ++misses_;
+        return std::nullopt;
+    }
+
+    void Put(const Key& key, Value value) {
+        if (capacity_ == 0) {
+            return;
+        }
+
+        std::lock_guard guard(mutex_);
+        if (const auto it = index_.find(key); it != index_.end()) {
+            it->second->second = std::move(value);
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return;
+        }
+
+        entries_.emplace_front(key, std::move(value));
+        index_.emplace(key, entries_.begin());
+        if (entries_.size() > capacity_) {
+            index_.erase(entries_.back().first);
+            entries_.pop_back();
+        }
+    }
+
+    size_t GetCapacity() const {
+        return capacity_;
+    }
+
+    CacheStats GetStats() const {
+        return {hits_.load(), misses_.load()};
+    }
+
+private:
+    using Entries = std::list<std::pair<Key, Value>>;
+
+    const size_t capacity_;
+
+    std::mutex mutex_;
+    Entries entries_;
+    std::unordered_map<Key, typename Entries::iterator, Hash> index_;
+
+    std::atomic<size_t> hits_{0};
+    std::atomic<size_t> misses_{0};
+};
+
+} // namespace cache
@@ -5,10 +5,14 @@
 #include "transport_catalogue.h"
 #include "transport_router.h"
 #include "router.h"
+#include "relax_kernel.h"
 #include "serialization.h"
 
+#include <charconv>
 #include <fstream>
 #include <iostream>
+#include <optional>
+#include <stdexcept>
 #include <string_view>
 
 // #include "tests.h"
@@ -17,32 +21,118 @@ using namespace std;
 using namespace transport_catalogue;
 using namespace renderer;
 
+// --threads задаёт потоки предподсчёта таблицы маршрутов в make_base,
+// --request-threads — потоки обработки запросов в process_requests
+struct Options {
+    graph::PrecomputeSettings precompute_settings;
+    size_t request_thread_count = 1;
+    size_t route_cache_capacity = TransportRouter::DEFAULT_ROUTE_CACHE_CAPACITY;
+    bool print_stats = false;
+};
+
 void PrintUsage(std::ostream& stream = std::cerr) {
-    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+    stream << "Usage: transport_catalogue [make_base|process_requests] [--threads N]"
+              " [--request-threads N] [--relax-kernel auto|scalar|sse4|avx2] [--route-cache-size N] [--stats]\n"sv;
+}
+
+std::optional<size_t> ParseNumber(std::string_view text) {
+    size_t value = 0;
+    const auto [ptr, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc{} || ptr != text.data() + text.size()) {
+        return std::nullopt;
+    }
+    return value;
 }
 
-void MakeBase(const json::Document& document) {
+std::optional<graph::RelaxKernel> ParseRelaxKernel(std::string_view name) {
+    if (name == "auto"sv) {
+        return graph::RelaxKernel::Auto;
+    } else if (name == "scalar"sv) {
+        return graph::RelaxKernel::Scalar;
+    } else if (name == "sse4"sv) {
+        return graph::RelaxKernel::Sse4;
+    } else if (name == "avx2"sv) {
+        return graph::RelaxKernel::Avx2;
+    }
+    return std::nullopt;
+}
+
+std::optional<Options> ParseOptions(int argc, char* argv[]) {
+    Options options;
+    for (int i = 2; i < argc; ++i) {
+        const std::string_view option(argv[i]);
+        if (option == "--threads"sv && i + 1 < argc) {
+            const auto thread_count = ParseNumber(argv[++i]);
+            if (!thread_count || *thread_count == 0) {
+                return std::nullopt;
+            }
+            options.precompute_settings.thread_count = *thread_count;
+        } else if (option == "--request-threads"sv && i + 1 < argc) {
+            const auto thread_count = ParseNumber(argv[++i]);
+            if (!thread_count || *thread_count == 0) {
+                return std::nullopt;
+            }
+            options.request_thread_count = *thread_count;
+        } else if (option == "--relax-kernel"sv && i + 1 < argc) {
+            const auto relax_kernel = ParseRelaxKernel(argv[++i]);
+            // Ядро, которое процессор не поддерживает, — такая же ошибка в аргументах, как неизвестное имя
+            if (!relax_kernel || !graph::IsRelaxKernelSupported(*relax_kernel)) {
+                return std::nullopt;
+            }
+            options.precompute_settings.relax_kernel = *relax_kernel;
+        } else if (option == "--route-cache-size"sv && i + 1 < argc) {
+            const auto capacity = ParseNumber(argv[++i]);
+            if (!capacity) {
+                return std::nullopt;
+            }
+            options.route_cache_capacity = *capacity;
+        } else if (option == "--stats"sv) {
+            options.print_stats = true;
+        } else {
+            return std::nullopt;
+        }
+    }
+    return options;
+}
+
+void MakeBase(std::istream& input, const Options& options) {
     TransportCatalogue transport_catalogue;
-    ParseBaseRequests(transport_catalogue, document);
+    // Запросы base_requests попадают в справочник по ходу разбора, в документе остаются только настройки.
+    // Буфер с текстом запроса освобождается сразу после разбора
+    const auto document = ParseBaseDocument(transport_catalogue, json::ReadAll(input));
 
     MapRenderer map_renderer(ParseRenderSettings(document));
 
-    TransportRouter transport_router(ParseRoutingSettings(document), transport_catalogue);
+    TransportRouter transport_router(ParseRoutingSettings(document), transport_catalogue,
+                                     options.precompute_settings);
+
+    if (const auto* graph = transport_router.GetGraph(); graph && options.print_stats) {
+        cerr << "Routing graph: "sv << graph->GetVertexCount() << " vertices, "sv
+             << graph->GetEdgeCount() << " edges, "sv
+             << transport_router.GetPrunedEdgeCount() << " dominated edges pruned\n"sv;
+    }
 
     const auto& serialization_settings = ParseSerializationSettings(document);
     ofstream ofs(serialization_settings.file, ios::binary);
     transport_catalogue_serialize::Serialize(transport_catalogue, map_renderer, transport_router, ofs);
 }
 
-void ProcessRequests(const json::Document& document) {
+void ProcessRequests(const json::Document& document, const Options& options) {
     const auto& serialization_settings = ParseSerializationSettings(document);
     ifstream ifs(serialization_settings.file, ios::binary);
 
     if (auto result = transport_catalogue_serialize::Deserialize(ifs)) {
         auto& [transport_catalogue, map_renderer, transport_router] = *result;
 
+        transport_router.SetRouteCacheCapacity(options.route_cache_capacity);
+
         RequestHandler request_handler(transport_catalogue, map_renderer, transport_router);
-        ParseStatRequests(request_handler, document, cout);
+        ParseStatRequests(request_handler, document, cout, options.request_thread_count);
+
+        if (options.print_stats) {
+            const auto cache_stats = transport_router.GetRouteCacheStats();
+            cerr << "Route cache: "sv << cache_stats.hits << " hits, "sv << cache_stats.misses << " misses\n"sv;
+        }
 
         // request_handler.RenderMap().Render(cout);
     }
@@ -51,20 +141,33 @@ void ProcessRequests(const json::Document& document) {
 int main(int argc, char* argv[]) {
     // TestAll();
 
-    if (argc != 2) {
+    if (argc < 2) {
         PrintUsage();
         return 1;
     }
 
-    const auto& document = json::Load(cin);
-    const std::string_view mode(argv[1]);
+    const auto options = ParseOptions(argc, argv);
+    if (!options) {
+        PrintUsage();
+        return 1;
+    }
 
-    if (mode == "make_base"sv) {
-        MakeBase(document);
-    } else if (mode == "process_requests"sv) {
-        ProcessRequests(document);
-    } else {
+    const std::string_view mode(argv[1]);
+    if (mode != "make_base"sv && mode != "process_requests"sv) {
         PrintUsage();
         return 1;
     }
+
+    // Недопустимые настройки во входном документе и повреждённая база — ошибка входных данных,
+    // а не сбой программы: сообщение выводится без аварийного завершения
+    try {
+        if (mode == "make_base"sv) {
+            MakeBase(cin, *options);
+        } else {
+            ProcessRequests(json::Load(cin), *options);
+        }
+    } catch (const std::invalid_argument& e) {
+        cerr << e.what() << '\n';
+        return 1;
+    }
 }
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+namespace graph {
+
+// Стоимость выбора ребра: решает только между путями равного веса
+using TieCost = uint64_t;
+
+// Веса с плавающей точкой считаются равными, если отличаются не больше чем на эту долю.
+// Движки складывают веса рёбер одного пути в разном порядке (таблица всех пар — через промежуточные
+// вершины, двунаправленные поиски — с двух концов), и веса равных путей расходятся в последних битах
+inline constexpr double WEIGHT_RELATIVE_TOLERANCE = 1e-9;
+
+template <typename Weight>
+bool AreWeightsEqual(const Weight& lhs, const Weight& rhs) {
+    if constexpr (std::is_floating_point_v<Weight>) {
+        // Бесконечный вес равен только бесконечному
+        if (lhs == rhs || !std::isfinite(lhs) || !std::isfinite(rhs)) {
+            return lhs == rhs;
+        }
+        return std::abs(lhs - rhs) <= WEIGHT_RELATIVE_TOLERANCE * std::max({Weight{1}, std::abs(lhs), std::abs(rhs)});
+    } else {
+        return lhs == rhs;
+    }
+}
+
+// Ключ сравнения путей: вес, а при равных весах — сумма стоимостей выбора рёбер.
+// Ключ складывается по рёбрам, как вес, поэтому любой поиск кратчайших путей по ключам
+// находит путь наименьшего веса, а среди равных по весу — один и тот же путь наименьшей стоимости выбора,
+// каким бы ни был порядок обхода. Так все движки выбирают одинаковые маршруты
+template <typename Weight>
+struct PathKey {
+    Weight weight{};
+    TieCost tie = 0;
+
+    PathKey operator+(const PathKey& other) const {
+        return {weight + other.weight, tie + other.tie};
+    }
+
+    bool operator<(const PathKey& other) const {
+        return AreWeightsEqual(weight, other.weight) ? tie < other.tie : weight < other.weight;
+    }
+
+    bool operator>(const PathKey& other) const {
+        return other < *this;
+    }
+};
+
+}  // namespace graph
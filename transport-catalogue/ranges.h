@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <iterator>
 #include <string_view>
 #include <unordered_map>
@@ -33,4 +34,51 @@ auto AsRange(const C& container) {
     return Range{container.begin(), container.end()};
 }
 
+// Итератор по последовательным индексам [begin, end) без хранения самих индексов
+template <typename Index>
+class IndexIterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Index;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Index*;
+    using reference = Index;
+
+    IndexIterator() = default;
+    explicit IndexIterator(Index index)
+        : index_(index) {
+    }
+
+    Index operator*() const {
+        return index_;
+    }
+
+    IndexIterator& operator++() {
+        ++index_;
+        return *this;
+    }
+
+    IndexIterator operator++(int) {
+        auto copy = *this;
+        ++index_;
+        return copy;
+    }
+
+    bool operator==(const IndexIterator& other) const {
+        return index_ == other.index_;
+    }
+
+    bool operator!=(const IndexIterator& other) const {
+        return index_ != other.index_;
+    }
+
+private:
+    Index index_{};
+};
+
+template <typename Index>
+auto AsIndexRange(Index begin, Index end) {
+    return Range{IndexIterator<Index>{begin}, IndexIterator<Index>{end}};
+}
+
 }  // namespace ranges
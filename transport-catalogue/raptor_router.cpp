@@ -0,0 +1,268 @@
+#include "raptor_router.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace transport_catalogue {
+
+using namespace std;
+
+// Хеш splitmix64 пары номеров: равномерный и одинаковый на всех платформах, в отличие от std::hash
+graph::TieCost GetRideTieCost(BusId bus, StopId stop) {
+    static constexpr int HASH_BITS = 24;
+    static constexpr graph::TieCost RIDE_COST = graph::TieCost{1} << 32;
+
+    uint64_t hash = (uint64_t{bus} << 32 | stop) + 0x9e3779b97f4a7c15;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111eb;
+    hash ^= hash >> 31;
+    return RIDE_COST + (hash >> (64 - HASH_BITS));
+}
+
+RaptorRouter::RaptorRouter(const TransportCatalogue& transport_catalogue, double bus_wait_time, double bus_velocity) :
+    bus_wait_time_(bus_wait_time),
+    states_(transport_catalogue.GetStopsCount()) {
+
+    stops_.reserve(transport_catalogue.GetStopsCount());
+    for (const auto& stop : transport_catalogue.GetStopsRange()) {
+        stops_.push_back(&stop);
+    }
+
+    routes_by_stop_.resize(stops_.size());
+    for (const auto& bus : transport_catalogue.GetBusesRange()) {
+        if (bus.stops.empty()) {
+            continue;
+        }
+
+        const auto stops = MakeRoute(bus);
+        Route route{&bus, {}, {}};
+        route.stops.reserve(stops.size());
+        route.segment_times.reserve(stops.size() - 1);
+
+        for (auto it = stops.begin(); it != stops.end(); ++it) {
+            route.stops.push_back((*it)->id);
+
+            // Маршруты добавляются по возрастанию номеров, повтор остановки виден по последнему элементу
+            auto& routes = routes_by_stop_[(*it)->id];
+            if (routes.empty() || routes.back() != routes_.size()) {
+                routes.push_back(routes_.size());
+            }
+            if (next(it) != stops.end()) {
+                const double distance = transport_catalogue.GetDistance(**it, **next(it));
+                route.segment_times.push_back(distance / (1000 * bus_velocity) * 60);
+            }
+        }
+
+        routes_.push_back(move(route));
+    }
+}
+
+optional<RaptorJourney> RaptorRouter::BuildRoute(const Stop& from, const Stop& to) const {
+    auto state = states_.Acquire();
+    RunRounds(*state, from.id, to.id, UNREACHABLE);
+
+    optional<RaptorJourney> journey;
+    if (state->best_keys[to.id].weight != UNREACHABLE) {
+        journey = RestoreJourney(*state, from.id, to.id);
+    }
+
+    states_.Release(move(state));
+    return journey;
+}
+
+vector<optional<RaptorArrival>> RaptorRouter::FindArrivals(const Stop& from, const vector<StopPtr>& to) const {
+    auto state = states_.Acquire();
+    RunRounds(*state, from.id, NO_STOP, UNREACHABLE);
+
+    vector<optional<RaptorArrival>> arrivals;
+    arrivals.reserve(to.size());
+    for (const StopPtr to_stop : to) {
+        const double total_time = state->best_keys[to_stop->id].weight;
+        if (total_time == UNREACHABLE) {
+            arrivals.emplace_back();
+        } else {
+            arrivals.push_back(RaptorArrival{total_time, CountSpans(*state, from.id, to_stop->id)});
+        }
+    }
+
+    states_.Release(move(state));
+    return arrivals;
+}
+
+vector<pair<StopPtr, double>> RaptorRouter::FindReachableStops(const Stop& from, double max_time) const {
+    auto state = states_.Acquire();
+    RunRounds(*state, from.id, NO_STOP, max_time);
+
+    vector<pair<StopPtr, double>> reachable_stops;
+    for (size_t stop = 0; stop < stops_.size(); ++stop) {
+        if (state->best_keys[stop].weight <= max_time) {
+            reachable_stops.emplace_back(stops_[stop], state->best_keys[stop].weight);
+        }
+    }
+
+    states_.Release(move(state));
+    return reachable_stops;
+}
+
+void RaptorRouter::QueryState::Reset(size_t route_count) {
+    for (const size_t stop : reached_stops) {
+        best_keys[stop] = UNREACHABLE_KEY;
+        previous_keys[stop] = UNREACHABLE_KEY;
+    }
+    reached_stops.clear();
+    improved_stops.clear();
+
+    round_count = 0;
+    if (++generation == 0) {
+        for (auto& round : rounds) {
+            fill(round.marks.begin(), round.marks.end(), 0);
+        }
+        generation = 1;
+    }
+
+    // После каждого запроса все отметки маршрутов сняты, поэтому достаточно выделить их один раз
+    is_route_marked.resize(route_count, false);
+}
+
+void RaptorRouter::QueryState::StartRound() {
+    if (round_count == rounds.size()) {
+        rounds.emplace_back(best_keys.size());
+    }
+    ++round_count;
+}
+
+void RaptorRouter::QueryState::Improve(size_t stop, const Label& label) {
+    auto& round = rounds[round_count - 1];
+    if (round.marks[stop] != generation) {
+        round.marks[stop] = generation;
+        improved_stops.push_back(stop);
+    }
+    if (best_keys[stop].weight == UNREACHABLE) {
+        reached_stops.push_back(stop);
+    }
+    round.labels[stop] = label;
+    best_keys[stop] = label.key;
+}
+
+void RaptorRouter::RunRounds(QueryState& state, size_t source, size_t target, double max_time) const {
+    state.Reset(routes_.size());
+    state.StartRound();
+    state.Improve(source, {Key{}});
+
+    while (!state.improved_stops.empty()) {
+        // Прибытия, улучшенные в прошлом раунде, становятся остановками посадки этого раунда
+        for (const size_t stop : state.improved_stops) {
+            state.previous_keys[stop] = state.best_keys[stop];
+            for (const size_t route : routes_by_stop_[stop]) {
+                if (!state.is_route_marked[route]) {
+                    state.is_route_marked[route] = true;
+                    state.marked_routes.push_back(route);
+                }
+            }
+        }
+        state.improved_stops.clear();
+
+        // Маршруты просматриваются в порядке справочника, чтобы ответ не зависел от порядка хеш-таблиц
+        sort(state.marked_routes.begin(), state.marked_routes.end());
+
+        state.StartRound();
+        for (const size_t route : state.marked_routes) {
+            state.is_route_marked[route] = false;
+            ScanRoute(state, route, target, max_time);
+        }
+        state.marked_routes.clear();
+    }
+}
+
+// Проходит маршрут, поддерживая лучшую посадку среди пройденных остановок: прибытие на остановку
+// с меньшим числом посадок плюс ожидание и стоимость выбора поездки. Прибытие на очередную остановку —
+// посадка плюс время в пути, сложенные в том же порядке, что и веса рёбер графа, поэтому время совпадает
+// с остальными движками. Стоимость выбора зависит только от автобуса и остановки посадки,
+// поэтому лучшая посадка остаётся лучшей и для всех следующих остановок маршрута
+void RaptorRouter::ScanRoute(QueryState& state, size_t route_index, size_t target, double max_time) const {
+    const auto& route = routes_[route_index];
+
+    size_t boarding_position = NO_STOP;
+    Key boarding_key;
+    double ride_time = 0.0;
+
+    for (size_t position = 0; position < route.stops.size(); ++position) {
+        const size_t stop = route.stops[position];
+
+        if (boarding_position != NO_STOP) {
+            const Key arrival_key = boarding_key + Key{ride_time, 0};
+            // Прибытия не лучше уже найденного на конечную остановку не могут улучшить ответ
+            const bool is_useful = arrival_key.weight <= max_time
+                && (target == NO_STOP || arrival_key < state.best_keys[target]);
+            if (is_useful && arrival_key < state.best_keys[stop]) {
+                state.Improve(stop, {
+                    arrival_key,
+                    route.stops[boarding_position],
+                    route_index,
+                    static_cast<int>(position - boarding_position),
+                    ride_time
+                });
+            }
+        }
+
+        if (state.previous_keys[stop].weight != UNREACHABLE) {
+            const Key candidate_key = state.previous_keys[stop]
+                + Key{bus_wait_time_, GetRideTieCost(route.bus->id, stops_[stop]->id)};
+            if (boarding_position == NO_STOP || candidate_key < boarding_key + Key{ride_time, 0}) {
+                boarding_position = position;
+                boarding_key = candidate_key;
+                ride_time = 0.0;
+            }
+        }
+
+        if (boarding_position != NO_STOP && position + 1 < route.stops.size()) {
+            ride_time += route.segment_times[position];
+        }
+    }
+}
+
+// Метка остановки, по которой она достигнута не более чем за round поездок, лежит в последнем
+// из раундов до round включительно, где остановка улучшалась. Остановка посадки улучшалась
+// раньше раунда поездки, а остановка отправления — в нулевом раунде
+size_t RaptorRouter::FindLabelRound(const QueryState& state, size_t stop, size_t round) {
+    while (!state.IsImproved(round, stop)) {
+        --round;
+    }
+    return round;
+}
+
+RaptorJourney RaptorRouter::RestoreJourney(const QueryState& state, size_t source, size_t target) const {
+    size_t round = FindLabelRound(state, target, state.round_count - 1);
+    RaptorJourney journey{state.rounds[round].labels[target].key.weight, {}};
+
+    size_t stop = target;
+    while (stop != source) {
+        const auto& label = state.rounds[round].labels[stop];
+        journey.legs.push_back({
+            stops_[label.boarding_stop],
+            routes_[label.route].bus,
+            label.span_count,
+            label.ride_time
+        });
+        stop = label.boarding_stop;
+        round = FindLabelRound(state, stop, round - 1);
+    }
+    reverse(journey.legs.begin(), journey.legs.end());
+
+    return journey;
+}
+
+int RaptorRouter::CountSpans(const QueryState& state, size_t source, size_t target) const {
+    int span_count = 0;
+    size_t round = FindLabelRound(state, target, state.round_count - 1);
+    for (size_t stop = target; stop != source;) {
+        const auto& label = state.rounds[round].labels[stop];
+        span_count += label.span_count;
+        stop = label.boarding_stop;
+        round = FindLabelRound(state, stop, round - 1);
+    }
+    return span_count;
+}
+
+} // namespace transport_catalogue
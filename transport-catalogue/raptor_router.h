@@ -0,0 +1,156 @@
+#pragma once
+#include "domain.h"
+#include "path_key.h"
+#include "search_state.h"
+#include "transport_catalogue.h"
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace transport_catalogue {
+
+// Стоимость выбора поездки на автобусе bus с посадкой на остановке stop для ключа graph::PathKey.
+// Единица в старших разрядах делает из маршрутов равного времени предпочтительным маршрут с меньшим числом
+// поездок, а хеш в младших однозначно выбирает между поездками на разных автобусах и с разных остановок.
+// Рёбра автобусов графа маршрутов получают ту же стоимость, рёбра ожидания — нулевую
+graph::TieCost GetRideTieCost(BusId bus, StopId stop);
+
+// Поездка на одном автобусе от остановки посадки через span_count перегонов
+struct RaptorLeg {
+    StopPtr boarding_stop;
+    BusPtr bus;
+    int span_count;
+    double time;
+};
+
+struct RaptorJourney {
+    double total_time;
+    std::vector<RaptorLeg> legs;
+};
+
+// Время в пути и суммарное число перегонов маршрута без самих поездок
+struct RaptorArrival {
+    double total_time;
+    int span_count;
+};
+
+// Ищет маршруты по раундам (RAPTOR) прямо по последовательностям остановок автобусов, без графа.
+// Раунд k находит лучшие маршруты не более чем с k посадками: каждый автобус, проходящий через
+// остановку, улучшенную в предыдущем раунде, просматривается один раз вдоль своего маршрута.
+// Каждая посадка стоит bus_wait_time. Раунд линеен по суммарной длине маршрутов,
+// а не по её квадрату, как число рёбер графа. Прибытия сравниваются по ключу graph::PathKey
+// со стоимостью GetRideTieCost за поездку, поэтому из маршрутов равного времени выбирается тот же,
+// что и у движков по графу. Константные методы потокобезопасны.
+class RaptorRouter {
+public:
+    RaptorRouter(const TransportCatalogue& transport_catalogue, double bus_wait_time, double bus_velocity);
+
+    std::optional<RaptorJourney> BuildRoute(const Stop& from, const Stop& to) const;
+
+    // Прибытия из from на каждую из остановок to в том же порядке, найденные одним поиском без цели.
+    // Маршрут до каждой остановки тот же, что у BuildRoute. Пустой элемент — маршрута нет
+    std::vector<std::optional<RaptorArrival>> FindArrivals(const Stop& from, const std::vector<StopPtr>& to) const;
+
+    // Наименьшие времена в пути до всех остановок, достижимых из from не дольше чем за max_time,
+    // в порядке справочника. Сама остановка from входит в ответ с нулевым временем
+    std::vector<std::pair<StopPtr, double>> FindReachableStops(const Stop& from, double max_time) const;
+
+private:
+    static constexpr double UNREACHABLE = std::numeric_limits<double>::infinity();
+    static constexpr size_t NO_STOP = std::numeric_limits<size_t>::max();
+
+    using Key = graph::PathKey<double>;
+    static constexpr Key UNREACHABLE_KEY{UNREACHABLE, 0};
+
+    // Маршрут автобуса в порядке MakeRoute: segment_times[i] — время в пути от stops[i] до stops[i + 1]
+    struct Route {
+        BusPtr bus;
+        std::vector<size_t> stops;
+        std::vector<double> segment_times;
+    };
+
+    // Прибытие на остановку, улучшенное в раунде, и последняя поездка к нему
+    struct Label {
+        Key key = UNREACHABLE_KEY;
+        size_t boarding_stop = NO_STOP;
+        size_t route = 0;
+        int span_count = 0;
+        double ride_time = 0.0;
+    };
+
+    // Метки одного раунда. Метка действительна, только если её отметка совпадает с поколением
+    // состояния поиска: раунд хранит лишь остановки, улучшенные в нём, и между запросами не очищается
+    struct RoundLabels {
+        explicit RoundLabels(size_t stop_count)
+            : labels(stop_count)
+            , marks(stop_count, 0) {
+        }
+
+        std::vector<Label> labels;
+        std::vector<uint32_t> marks;
+    };
+
+    // Буферы одного запроса, переиспользуемые между запросами. Массивы времён между запросами
+    // возвращаются к UNREACHABLE_KEY только в остановках, достигнутых прошлым запросом
+    struct QueryState {
+        explicit QueryState(size_t stop_count)
+            : best_keys(stop_count, UNREACHABLE_KEY)
+            , previous_keys(stop_count, UNREACHABLE_KEY) {
+        }
+
+        void Reset(size_t route_count);
+
+        // Начинает следующий раунд, выделяя его метки, только если прошлые запросы не дошли до него
+        void StartRound();
+
+        // Записывает улучшенное прибытие на остановку в текущий раунд
+        void Improve(size_t stop, const Label& label);
+
+        bool IsImproved(size_t round, size_t stop) const {
+            return rounds[round].marks[stop] == generation;
+        }
+
+        // Наименьшие ключи прибытия, найденные до сих пор
+        std::vector<Key> best_keys;
+        // Наименьшие ключи прибытия с числом посадок меньше номера текущего раунда
+        std::vector<Key> previous_keys;
+        std::vector<size_t> reached_stops;
+
+        // Раунды, выделенные прошлыми запросами, остаются в векторе, round_count — число раундов этого запроса
+        std::vector<RoundLabels> rounds;
+        size_t round_count = 0;
+        uint32_t generation = 0;
+
+        std::vector<size_t> improved_stops;
+        std::vector<bool> is_route_marked;
+        std::vector<size_t> marked_routes;
+    };
+
+    // Выполняет раунды, пока они улучшают прибытия. Прибытия позже max_time или, если задана
+    // target, не раньше лучшего прибытия на неё отбрасываются
+    void RunRounds(QueryState& state, size_t source, size_t target, double max_time) const;
+
+    void ScanRoute(QueryState& state, size_t route_index, size_t target, double max_time) const;
+
+    // Последний раунд не позже round, в котором улучшалось прибытие на остановку
+    static size_t FindLabelRound(const QueryState& state, size_t stop, size_t round);
+
+    RaptorJourney RestoreJourney(const QueryState& state, size_t source, size_t target) const;
+
+    int CountSpans(const QueryState& state, size_t source, size_t target) const;
+
+    const double bus_wait_time_;
+
+    // Индексы остановок совпадают с их номерами в справочнике
+    std::vector<StopPtr> stops_;
+    std::vector<Route> routes_;
+    // Номера маршрутов, проходящих через остановку, по возрастанию
+    std::vector<std::vector<size_t>> routes_by_stop_;
+
+    graph::SearchStatePool<QueryState> states_;
+};
+
+} // namespace transport_catalogue
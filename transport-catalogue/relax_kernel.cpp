@@ -0,0 +1,145 @@
+#include "relax_kernel.h"
+
+#include <stdexcept>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define TRANSPORT_CATALOGUE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace graph {
+
+using namespace std;
+
+namespace {
+
+void RelaxRowScalar(double* weights, uint32_t* prev_edges,
+                    double weight_from, uint32_t prev_edge_from,
+                    const double* weights_through, const uint32_t* prev_edges_through,
+                    size_t begin, size_t end) {
+    for (size_t to = begin; to < end; ++to) {
+        const double candidate_weight = weight_from + weights_through[to];
+        if (candidate_weight < weights[to]) {
+            weights[to] = candidate_weight;
+            prev_edges[to] = prev_edges_through[to] != NO_PREV_EDGE ? prev_edges_through[to] : prev_edge_from;
+        }
+    }
+}
+
+#ifdef TRANSPORT_CATALOGUE_X86_KERNELS
+
+// Векторные ядра выполняют те же сложения и сравнения (<, упорядоченное), что и скалярное,
+// и записывают ячейки через blend, поэтому их результат совпадает со скалярным побитово
+
+__attribute__((target("sse4.1")))
+void RelaxRowSse4(double* weights, uint32_t* prev_edges,
+                  double weight_from, uint32_t prev_edge_from,
+                  const double* weights_through, const uint32_t* prev_edges_through,
+                  size_t begin, size_t end) {
+    const __m128d weight_from_vector = _mm_set1_pd(weight_from);
+    const __m128i prev_edge_from_vector = _mm_set1_epi32(static_cast<int>(prev_edge_from));
+    const __m128i no_edge_vector = _mm_set1_epi32(-1);
+
+    size_t to = begin;
+    for (; to + 2 <= end; to += 2) {
+        const __m128d candidate_weights = _mm_add_pd(weight_from_vector, _mm_loadu_pd(weights_through + to));
+        const __m128d current_weights = _mm_loadu_pd(weights + to);
+        const __m128d improved = _mm_cmplt_pd(candidate_weights, current_weights);
+        if (_mm_movemask_pd(improved) == 0) {
+            continue;
+        }
+        _mm_storeu_pd(weights + to, _mm_blendv_pd(current_weights, candidate_weights, improved));
+
+        const __m128i edges_through = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(prev_edges_through + to));
+        const __m128i candidate_edges = _mm_blendv_epi8(
+            edges_through, prev_edge_from_vector, _mm_cmpeq_epi32(edges_through, no_edge_vector));
+        const __m128i improved_lanes = _mm_shuffle_epi32(_mm_castpd_si128(improved), _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128i current_edges = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(prev_edges + to));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(prev_edges + to),
+                         _mm_blendv_epi8(current_edges, candidate_edges, improved_lanes));
+    }
+    RelaxRowScalar(weights, prev_edges, weight_from, prev_edge_from, weights_through, prev_edges_through, to, end);
+}
+
+__attribute__((target("avx2")))
+void RelaxRowAvx2(double* weights, uint32_t* prev_edges,
+                  double weight_from, uint32_t prev_edge_from,
+                  const double* weights_through, const uint32_t* prev_edges_through,
+                  size_t begin, size_t end) {
+    const __m256d weight_from_vector = _mm256_set1_pd(weight_from);
+    const __m128i prev_edge_from_vector = _mm_set1_epi32(static_cast<int>(prev_edge_from));
+    const __m128i no_edge_vector = _mm_set1_epi32(-1);
+    const __m256i low_halves = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+
+    size_t to = begin;
+    for (; to + 4 <= end; to += 4) {
+        const __m256d candidate_weights = _mm256_add_pd(weight_from_vector, _mm256_loadu_pd(weights_through + to));
+        const __m256d current_weights = _mm256_loadu_pd(weights + to);
+        const __m256d improved = _mm256_cmp_pd(candidate_weights, current_weights, _CMP_LT_OQ);
+        if (_mm256_movemask_pd(improved) == 0) {
+            continue;
+        }
+        _mm256_storeu_pd(weights + to, _mm256_blendv_pd(current_weights, candidate_weights, improved));
+
+        const __m128i edges_through = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev_edges_through + to));
+        const __m128i candidate_edges = _mm_blendv_epi8(
+            edges_through, prev_edge_from_vector, _mm_cmpeq_epi32(edges_through, no_edge_vector));
+        const __m128i improved_lanes = _mm256_castsi256_si128(
+            _mm256_permutevar8x32_epi32(_mm256_castpd_si256(improved), low_halves));
+        const __m128i current_edges = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev_edges + to));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(prev_edges + to),
+                         _mm_blendv_epi8(current_edges, candidate_edges, improved_lanes));
+    }
+    RelaxRowScalar(weights, prev_edges, weight_from, prev_edge_from, weights_through, prev_edges_through, to, end);
+}
+
+#endif
+
+} // namespace
+
+bool IsRelaxKernelSupported(RelaxKernel kernel) {
+    switch (kernel) {
+        case RelaxKernel::Auto:
+        case RelaxKernel::Scalar:
+            return true;
+#ifdef TRANSPORT_CATALOGUE_X86_KERNELS
+        case RelaxKernel::Sse4:
+            return __builtin_cpu_supports("sse4.1");
+        case RelaxKernel::Avx2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+RelaxKernel ResolveRelaxKernel(RelaxKernel kernel) {
+    if (kernel != RelaxKernel::Auto) {
+        if (!IsRelaxKernelSupported(kernel)) {
+            throw invalid_argument("Relax kernel is not supported by this CPU");
+        }
+        return kernel;
+    }
+
+    for (const auto candidate : {RelaxKernel::Avx2, RelaxKernel::Sse4}) {
+        if (IsRelaxKernelSupported(candidate)) {
+            return candidate;
+        }
+    }
+    return RelaxKernel::Scalar;
+}
+
+RelaxRowFunction GetRelaxRowFunction(RelaxKernel kernel) {
+    switch (ResolveRelaxKernel(kernel)) {
+#ifdef TRANSPORT_CATALOGUE_X86_KERNELS
+        case RelaxKernel::Sse4:
+            return RelaxRowSse4;
+        case RelaxKernel::Avx2:
+            return RelaxRowAvx2;
+#endif
+        default:
+            return RelaxRowScalar;
+    }
+}
+
+} // namespace graph
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace graph {
+
+// Реализация шага релаксации min-plus для таблицы маршрутов с весами double
+enum class RelaxKernel {
+    Auto,
+    Scalar,
+    Sse4,
+    Avx2
+};
+
+inline constexpr uint32_t NO_PREV_EDGE = std::numeric_limits<uint32_t>::max();
+
+// Для каждой ячейки to из [begin, end):
+// если weight_from + weights_through[to] < weights[to], записывает в ячейку новый вес и последнее ребро
+// prev_edges_through[to], а если его нет (NO_PREV_EDGE) — prev_edge_from.
+// Недостижимость кодируется бесконечным весом.
+using RelaxRowFunction = void (*)(double* weights, uint32_t* prev_edges,
+                                  double weight_from, uint32_t prev_edge_from,
+                                  const double* weights_through, const uint32_t* prev_edges_through,
+                                  size_t begin, size_t end);
+
+// Проверяет, поддерживает ли процессор ядро
+bool IsRelaxKernelSupported(RelaxKernel kernel);
+
+// Заменяет Auto на лучшее доступное ядро.
+// Выбрасывает std::invalid_argument, если явно запрошенное ядро не поддерживается процессором
+RelaxKernel ResolveRelaxKernel(RelaxKernel kernel);
+
+RelaxRowFunction GetRelaxRowFunction(RelaxKernel kernel);
+
+} // namespace graph
@@ -21,10 +21,14 @@ std::optional<BusStat> RequestHandler::GetBusStat(const std::string_view& bus_na
     return db_.GetBusStat(bus_name);
 }
 
-const std::unordered_set<BusPtr>* RequestHandler::GetBusesByStop(const std::string_view& stop_name) const {
+const std::vector<BusId>* RequestHandler::GetBusesByStop(const std::string_view& stop_name) const {
     return db_.GetBusesByStop(stop_name);
 }
 
+const Bus& RequestHandler::GetBus(BusId id) const {
+    return db_.GetBus(id);
+}
+
 svg::Document RequestHandler::RenderMap() const {
     vector<BusPtr> buses;
     for (const auto& [_, bus] : db_) {
@@ -36,8 +40,60 @@ svg::Document RequestHandler::RenderMap() const {
     return renderer_.RenderMap(buses.begin(), buses.end());
 }
 
-optional<TransportRouter::RouteResult> RequestHandler::BuildRoute(string_view from, string_view to) const {
+TransportRouter::RouteResultPtr RequestHandler::BuildRoute(string_view from, string_view to) const {
+    if (!db_.HasStop(from) || !db_.HasStop(to)) {
+        return nullptr;
+    }
     return router_.BuildRoute(db_.FindStop(from), db_.FindStop(to));
 }
 
+vector<TransportRouter::RouteResultPtr> RequestHandler::BuildRoutes(string_view from,
+                                                                    const vector<string_view>& to) const {
+    vector<TransportRouter::RouteResultPtr> results(to.size());
+    if (!db_.HasStop(from)) {
+        return results;
+    }
+
+    vector<StopPtr> to_stops;
+    vector<size_t> known_indices;
+    for (size_t index = 0; index < to.size(); ++index) {
+        if (db_.HasStop(to[index])) {
+            to_stops.push_back(&db_.FindStop(to[index]));
+            known_indices.push_back(index);
+        }
+    }
+
+    auto routes = router_.BuildRoutes(db_.FindStop(from), to_stops);
+    for (size_t i = 0; i < routes.size(); ++i) {
+        results[known_indices[i]] = move(routes[i]);
+    }
+    return results;
+}
+
+optional<TransportRouter::RouteMatrix> RequestHandler::BuildRouteMatrix(const vector<string_view>& from,
+                                                                        const vector<string_view>& to,
+                                                                        bool with_span_counts) const {
+    vector<StopPtr> from_stops;
+    vector<StopPtr> to_stops;
+    for (auto [names, stops] : {pair{&from, &from_stops}, pair{&to, &to_stops}}) {
+        stops->reserve(names->size());
+        for (const auto name : *names) {
+            if (!db_.HasStop(name)) {
+                return nullopt;
+            }
+            stops->push_back(&db_.FindStop(name));
+        }
+    }
+
+    return router_.BuildRouteMatrix(from_stops, to_stops, with_span_counts);
+}
+
+optional<vector<TransportRouter::ReachableStop>> RequestHandler::FindReachableStops(string_view from,
+                                                                                  double max_time) const {
+    if (!db_.HasStop(from)) {
+        return nullopt;
+    }
+    return router_.FindReachableStops(db_.FindStop(from), max_time);
+}
+
 } // namespace transport_catalogue {
@@ -6,6 +6,8 @@
 
 #include <utility>
 #include <optional>
+#include <string_view>
+#include <vector>
 
 /*
  * Здесь можно было бы разместить код обработчика запросов к базе, содержащего логику, которую не
@@ -31,13 +33,29 @@ public:
     // Возвращает информацию о маршруте (запрос Bus)
     std::optional<BusStat> GetBusStat(const std::string_view& bus_name) const;
 
-    // Возвращает маршруты, проходящие через
-    const std::unordered_set<BusPtr>* GetBusesByStop(const std::string_view& stop_name) const;
+    // Возвращает номера маршрутов, проходящих через остановку
+    const std::vector<BusId>* GetBusesByStop(const std::string_view& stop_name) const;
+
+    const Bus& GetBus(BusId id) const;
 
     // Этот метод будет нужен в следующей части итогового проекта
     svg::Document RenderMap() const;
 
-    std::optional<TransportRouter::RouteResult> BuildRoute(std::string_view from, std::string_view to) const;
+    // Возвращает nullptr, если маршрута нет или какой-либо остановки нет в справочнике
+    TransportRouter::RouteResultPtr BuildRoute(std::string_view from, std::string_view to) const;
+
+    // Маршруты из from в каждую из остановок to в том же порядке, nullptr — как в BuildRoute
+    std::vector<TransportRouter::RouteResultPtr> BuildRoutes(std::string_view from,
+                                                             const std::vector<std::string_view>& to) const;
+
+    // Возвращает nullopt, если какой-либо остановки нет в справочнике
+    std::optional<TransportRouter::RouteMatrix> BuildRouteMatrix(const std::vector<std::string_view>& from,
+                                                                 const std::vector<std::string_view>& to,
+                                                                 bool with_span_counts) const;
+
+    // Возвращает nullopt, если остановки нет в справочнике
+    std::optional<std::vector<TransportRouter::ReachableStop>> FindReachableStops(std::string_view from,
+                                                                                  double max_time) const;
 
 private:
     // RequestHandler использует агрегацию объектов "Транспортный Справочник" и "Визуализатор Карты"
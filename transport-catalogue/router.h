@@ -1,32 +1,130 @@
 #pragma once
 
 #include "graph.h"
+#include "path_key.h"
 #include "ranges.h"
+#include "relax_kernel.h"
+#include "search_state.h"
+#include "thread_pool.h"
 
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <iterator>
+#include <limits>
 #include <optional>
 #include <stdexcept>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace graph {
 
+// Параметры предподсчёта таблицы маршрутов всех пар вершин
+struct PrecomputeSettings {
+    size_t thread_count = 1;
+    // Используется только для весов double, для остальных типов релаксация всегда скалярная
+    RelaxKernel relax_kernel = RelaxKernel::Auto;
+};
+
 template <typename Weight>
 class Router {
+    static_assert(std::numeric_limits<Weight>::has_infinity, "Weight should be able to represent infinity");
+
 public:
     using Graph = DirectedWeightedGraph<Weight>;
 
-    explicit Router(const Graph& graph);
+    // Из маршрутов равного веса таблица хранит маршрут наименьшей суммы стоимостей выбора рёбер,
+    // как DijkstraRouter с ключом PathKey.
+    // Выбрасывает std::invalid_argument, если стоимостей выбора не столько же, сколько рёбер
+    Router(const Graph& graph, const std::vector<TieCost>& tie_costs, const PrecomputeSettings& settings = {});
 
     struct RouteInternalData {
         Weight weight;
         std::optional<EdgeId> prev_edge;
     };
-    using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+
+    // Таблица маршрутов всех пар вершин. Веса и последние рёбра маршрутов хранятся
+    // в двух непрерывных буферах построчно (строка — вершина from): 12 байт на ячейку
+    // вместо ~32 байт у вложенных векторов optional. Недостижимость кодируется
+    // бесконечным весом, отсутствие ребра (маршрут из вершины в саму себя) — NO_EDGE.
+    class RoutesInternalData {
+    public:
+        using PrevEdge = uint32_t;
+        static constexpr PrevEdge NO_EDGE = std::numeric_limits<PrevEdge>::max();
+        static constexpr Weight UNREACHABLE = std::numeric_limits<Weight>::infinity();
+
+        RoutesInternalData() = default;
+
+        explicit RoutesInternalData(size_t vertex_count)
+            : vertex_count_(vertex_count)
+            , weights_(vertex_count * vertex_count, UNREACHABLE)
+            , prev_edges_(vertex_count * vertex_count, NO_EDGE) {
+        }
+
+        RoutesInternalData(size_t vertex_count, std::vector<Weight> weights, std::vector<PrevEdge> prev_edges)
+            : vertex_count_(vertex_count)
+            , weights_(std::move(weights))
+            , prev_edges_(std::move(prev_edges)) {
+            if (weights_.size() != vertex_count * vertex_count || prev_edges_.size() != weights_.size()) {
+                throw std::invalid_argument("Routes table size does not match vertex count");
+            }
+        }
+
+        size_t GetVertexCount() const {
+            return vertex_count_;
+        }
+
+        std::optional<RouteInternalData> Get(VertexId from, VertexId to) const {
+            const size_t index = GetIndex(from, to);
+            if (weights_[index] == UNREACHABLE) {
+                return std::nullopt;
+            }
+            return RouteInternalData{weights_[index], ToEdgeId(prev_edges_[index])};
+        }
+
+        Weight* GetWeightsRow(VertexId from) {
+            return weights_.data() + from * vertex_count_;
+        }
+        const Weight* GetWeightsRow(VertexId from) const {
+            return weights_.data() + from * vertex_count_;
+        }
+
+        PrevEdge* GetPrevEdgesRow(VertexId from) {
+            return prev_edges_.data() + from * vertex_count_;
+        }
+        const PrevEdge* GetPrevEdgesRow(VertexId from) const {
+            return prev_edges_.data() + from * vertex_count_;
+        }
+
+        const std::vector<Weight>& GetWeights() const {
+            return weights_;
+        }
+
+        const std::vector<PrevEdge>& GetPrevEdges() const {
+            return prev_edges_;
+        }
+
+        static std::optional<EdgeId> ToEdgeId(PrevEdge prev_edge) {
+            if (prev_edge == NO_EDGE) {
+                return std::nullopt;
+            }
+            return prev_edge;
+        }
+
+    private:
+        size_t GetIndex(VertexId from, VertexId to) const {
+            if (from >= vertex_count_ || to >= vertex_count_) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+            return from * vertex_count_ + to;
+        }
+
+        size_t vertex_count_ = 0;
+        std::vector<Weight> weights_;
+        std::vector<PrevEdge> prev_edges_;
+    };
 
     Router(const Graph& graph, RoutesInternalData routes_data);
 
@@ -37,93 +135,324 @@ public:
 
     std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
-    auto GetRoutesRange() const {
-        return ranges::AsRange(routes_internal_data_);
+    // Передаёт callback рёбра маршрута из from в to от последнего к первому, не собирая их в вектор.
+    // Если маршрута нет или from совпадает с to, callback не вызывается
+    template <typename Callback>
+    void ForEachRouteEdgeBackward(VertexId from, VertexId to, Callback callback) const;
+
+    const RoutesInternalData& GetRoutesInternalData() const {
+        return routes_internal_data_;
     }
 
 private:
+    using PrevEdge = typename RoutesInternalData::PrevEdge;
+    using RelaxRowFunction = void (*)(Weight* weights, PrevEdge* prev_edges, Weight weight_from,
+                                      PrevEdge prev_edge_from, const Weight* weights_through,
+                                      const PrevEdge* prev_edges_through, size_t begin, size_t end);
+
+    static_assert(RoutesInternalData::NO_EDGE == NO_PREV_EDGE);
+
     void InitializeRoutesInternalData(const Graph& graph) {
+        if (graph.GetEdgeCount() >= RoutesInternalData::NO_EDGE) {
+            throw std::length_error("Too many edges for the routes table");
+        }
+
         const size_t vertex_count = graph.GetVertexCount();
         for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-            routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+            Weight* weights = routes_internal_data_.GetWeightsRow(vertex);
+            PrevEdge* prev_edges = routes_internal_data_.GetPrevEdgesRow(vertex);
+
+            weights[vertex] = ZERO_WEIGHT;
             for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
                 const auto& edge = graph.GetEdge(edge_id);
                 if (edge.weight < ZERO_WEIGHT) {
                     throw std::domain_error("Edges' weights should be non-negative");
                 }
-                auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                    route_internal_data = RouteInternalData{edge.weight, edge_id};
+                if (weights[edge.to] > edge.weight) {
+                    weights[edge.to] = edge.weight;
+                    prev_edges[edge.to] = static_cast<PrevEdge>(edge_id);
                 }
             }
         }
     }
 
-    void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-                    const RouteInternalData& route_to) {
-        auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-        const Weight candidate_weight = route_from.weight + route_to.weight;
-        if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-            route_relaxing = {candidate_weight,
-                              route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge};
-        }
-    }
-
-    void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-        for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-            if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                    if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                        RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
-                    }
-                }
+    // Релаксирует ячейки [begin, end) строки маршрутов из вершины from через вершину through.
+    // Недостижимые ячейки имеют бесконечный вес, поэтому кандидат через них
+    // никогда не оказывается меньше текущего значения и отдельная проверка не нужна
+    static void RelaxRow(Weight* weights, PrevEdge* prev_edges, Weight weight_from, PrevEdge prev_edge_from,
+                         const Weight* weights_through, const PrevEdge* prev_edges_through,
+                         size_t begin, size_t end) {
+        for (size_t vertex_to = begin; vertex_to < end; ++vertex_to) {
+            const Weight candidate_weight = weight_from + weights_through[vertex_to];
+            if (candidate_weight < weights[vertex_to]) {
+                weights[vertex_to] = candidate_weight;
+                prev_edges[vertex_to] = prev_edges_through[vertex_to] != RoutesInternalData::NO_EDGE
+                    ? prev_edges_through[vertex_to]
+                    : prev_edge_from;
             }
         }
     }
 
+    void ComputeRoutesInternalData(const PrecomputeSettings& settings);
+
+    void CanonicalizeRoutes(const std::vector<TieCost>& tie_costs, const PrecomputeSettings& settings);
+
+    static RelaxRowFunction GetRelaxRow(RelaxKernel kernel);
+
+    void RelaxPivotRows(RelaxRowFunction relax_row, VertexId block_begin, VertexId block_end,
+                        std::vector<Weight>& pivot_weights, std::vector<PrevEdge>& pivot_prev_edges);
+
+    void RelaxRowsThroughBlock(RelaxRowFunction relax_row, VertexId rows_begin, VertexId rows_end,
+                               VertexId block_begin, VertexId block_end,
+                               const std::vector<Weight>& pivot_weights, const std::vector<PrevEdge>& pivot_prev_edges);
+
+    static constexpr size_t BLOCK_SIZE = 32;
+    static constexpr size_t ROWS_PER_TASK = 32;
+    static constexpr size_t COLUMNS_PER_TILE = 256;
+
     static constexpr Weight ZERO_WEIGHT{};
     const Graph& graph_;
     RoutesInternalData routes_internal_data_;
 };
 
 template <typename Weight>
-Router<Weight>::Router(const Graph& graph)
+Router<Weight>::Router(const Graph& graph, const std::vector<TieCost>& tie_costs, const PrecomputeSettings& settings)
     : graph_(graph)
-    , routes_internal_data_(graph.GetVertexCount(),
-                            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+    , routes_internal_data_(graph.GetVertexCount())
 {
+    if (tie_costs.size() != graph.GetEdgeCount()) {
+        throw std::invalid_argument("Tie costs do not match edge count");
+    }
     InitializeRoutesInternalData(graph);
+    ComputeRoutesInternalData(settings);
+    CanonicalizeRoutes(tie_costs, settings);
+}
+
+// Блочный Floyd–Warshall. Промежуточные вершины обрабатываются блоками по BLOCK_SIZE:
+// сначала строки самого блока (диагональная плитка и его строка), затем остальные строки
+// плитками по ROWS_PER_TASK × COLUMNS_PER_TILE параллельно в пуле потоков.
+// На шаге k строка k и столбец k не меняются, поэтому каждая ячейка релаксируется
+// через те же промежуточные вершины, в том же порядке и с теми же слагаемыми,
+// что и в последовательном алгоритме, и результат совпадает с ним побитово.
+template <typename Weight>
+void Router<Weight>::ComputeRoutesInternalData(const PrecomputeSettings& settings) {
+    const size_t vertex_count = routes_internal_data_.GetVertexCount();
+    const RelaxRowFunction relax_row = GetRelaxRow(settings.relax_kernel);
+    concurrency::ThreadPool thread_pool(settings.thread_count);
+
+    std::vector<Weight> pivot_weights(std::min(BLOCK_SIZE, vertex_count) * vertex_count);
+    std::vector<PrevEdge> pivot_prev_edges(pivot_weights.size());
+
+    const size_t task_count = (vertex_count + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+    for (VertexId block_begin = 0; block_begin < vertex_count; block_begin += BLOCK_SIZE) {
+        const VertexId block_end = std::min(block_begin + BLOCK_SIZE, vertex_count);
 
-    const size_t vertex_count = graph.GetVertexCount();
-    for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-        RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+        RelaxPivotRows(relax_row, block_begin, block_end, pivot_weights, pivot_prev_edges);
+
+        thread_pool.ParallelFor(task_count, [&](size_t task) {
+            const VertexId rows_begin = task * ROWS_PER_TASK;
+            const VertexId rows_end = std::min(rows_begin + ROWS_PER_TASK, vertex_count);
+            RelaxRowsThroughBlock(relax_row, rows_begin, rows_end, block_begin, block_end,
+                                  pivot_weights, pivot_prev_edges);
+        });
+    }
+}
+
+// Floyd–Warshall выбирает из маршрутов равного веса тот, что найден раньше, а не тот, что выбрал бы
+// поиск Дейкстры по ключу PathKey. Маршрут наименьшего ключа проходит только по «тугим» рёбрам u → v,
+// у которых вес маршрута до u плюс вес ребра равен весу маршрута до v, поэтому для каждой строки
+// последние рёбра заново выбираются поиском Дейкстры по стоимостям выбора среди тугих рёбер.
+// Веса не меняются. Строки независимы и обрабатываются в пуле потоков, результат от числа потоков не зависит
+template <typename Weight>
+void Router<Weight>::CanonicalizeRoutes(const std::vector<TieCost>& tie_costs, const PrecomputeSettings& settings) {
+    using State = SearchState<TieCost>;
+
+    const size_t vertex_count = routes_internal_data_.GetVertexCount();
+    concurrency::ThreadPool thread_pool(settings.thread_count);
+
+    const size_t task_count = (vertex_count + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+    thread_pool.ParallelFor(task_count, [&](size_t task) {
+        State state(vertex_count);
+        const VertexId rows_begin = task * ROWS_PER_TASK;
+        const VertexId rows_end = std::min(rows_begin + ROWS_PER_TASK, vertex_count);
+
+        for (VertexId vertex_from = rows_begin; vertex_from < rows_end; ++vertex_from) {
+            const Weight* weights = routes_internal_data_.GetWeightsRow(vertex_from);
+            PrevEdge* prev_edges = routes_internal_data_.GetPrevEdgesRow(vertex_from);
+
+            state.Reset();
+            state.Reach(vertex_from, 0, State::NO_EDGE);
+            state.Push(vertex_from, 0);
+            while (!state.heap.empty()) {
+                const auto entry = state.Pop();
+                if (state.IsStale(entry)) {
+                    continue;
+                }
+                if (entry.vertex != vertex_from) {
+                    prev_edges[entry.vertex] = static_cast<PrevEdge>(state.prev_edges[entry.vertex]);
+                }
+
+                for (const EdgeId edge_id : graph_.GetIncidentEdges(entry.vertex)) {
+                    const auto& edge = graph_.GetEdge(edge_id);
+                    if (!AreWeightsEqual(weights[entry.vertex] + edge.weight, weights[edge.to])) {
+                        continue;
+                    }
+                    const TieCost tie = entry.weight + tie_costs[edge_id];
+                    if (!state.IsReached(edge.to) || tie < state.weights[edge.to]) {
+                        state.Reach(edge.to, tie, edge_id);
+                        state.Push(edge.to, tie);
+                    }
+                }
+            }
+        }
+    });
+}
+
+template <typename Weight>
+typename Router<Weight>::RelaxRowFunction Router<Weight>::GetRelaxRow(RelaxKernel kernel) {
+    if constexpr (std::is_same_v<Weight, double>) {
+        return GetRelaxRowFunction(kernel);
+    } else {
+        return &Router::RelaxRow;
+    }
+}
+
+// Проводит строки блока через все его промежуточные вершины по порядку и сохраняет
+// снимок строки k на момент шага k: именно с ним шаг k релаксирует остальные строки
+template <typename Weight>
+void Router<Weight>::RelaxPivotRows(RelaxRowFunction relax_row, VertexId block_begin, VertexId block_end,
+                                    std::vector<Weight>& pivot_weights, std::vector<PrevEdge>& pivot_prev_edges) {
+    const size_t vertex_count = routes_internal_data_.GetVertexCount();
+
+    for (VertexId vertex_through = block_begin; vertex_through < block_end; ++vertex_through) {
+        const Weight* weights_through = routes_internal_data_.GetWeightsRow(vertex_through);
+        const PrevEdge* prev_edges_through = routes_internal_data_.GetPrevEdgesRow(vertex_through);
+        const size_t pivot_offset = (vertex_through - block_begin) * vertex_count;
+        std::copy(weights_through, weights_through + vertex_count, pivot_weights.begin() + pivot_offset);
+        std::copy(prev_edges_through, prev_edges_through + vertex_count, pivot_prev_edges.begin() + pivot_offset);
+
+        for (VertexId vertex_from = block_begin; vertex_from < block_end; ++vertex_from) {
+            Weight* weights = routes_internal_data_.GetWeightsRow(vertex_from);
+            if (vertex_from == vertex_through || weights[vertex_through] == RoutesInternalData::UNREACHABLE) {
+                continue;
+            }
+            PrevEdge* prev_edges = routes_internal_data_.GetPrevEdgesRow(vertex_from);
+            relax_row(weights, prev_edges, weights[vertex_through], prev_edges[vertex_through],
+                     weights_through, prev_edges_through, 0, vertex_count);
+        }
     }
 }
 
+// Релаксирует строки [rows_begin, rows_end) вне блока через все вершины блока.
+// Сначала по порядку шагов обновляются столбцы блока и запоминаются значения (from, k)
+// на момент шага k, после чего остальные столбцы обрабатываются плитками,
+// пока снимки строк блока для плитки остаются в кеше
+template <typename Weight>
+void Router<Weight>::RelaxRowsThroughBlock(RelaxRowFunction relax_row, VertexId rows_begin, VertexId rows_end,
+                                           VertexId block_begin, VertexId block_end,
+                                           const std::vector<Weight>& pivot_weights,
+                                           const std::vector<PrevEdge>& pivot_prev_edges) {
+    const size_t vertex_count = routes_internal_data_.GetVertexCount();
+    const size_t block_size = block_end - block_begin;
+
+    std::vector<Weight> weights_from((rows_end - rows_begin) * block_size);
+    std::vector<PrevEdge> prev_edges_from(weights_from.size());
+
+    for (VertexId vertex_from = rows_begin; vertex_from < rows_end; ++vertex_from) {
+        if (block_begin <= vertex_from && vertex_from < block_end) {
+            continue;
+        }
+        Weight* weights = routes_internal_data_.GetWeightsRow(vertex_from);
+        PrevEdge* prev_edges = routes_internal_data_.GetPrevEdgesRow(vertex_from);
+        const size_t from_offset = (vertex_from - rows_begin) * block_size;
+
+        for (size_t pivot = 0; pivot < block_size; ++pivot) {
+            const Weight weight_from = weights[block_begin + pivot];
+            const PrevEdge prev_edge_from = prev_edges[block_begin + pivot];
+            weights_from[from_offset + pivot] = weight_from;
+            prev_edges_from[from_offset + pivot] = prev_edge_from;
+            if (weight_from != RoutesInternalData::UNREACHABLE) {
+                relax_row(weights, prev_edges, weight_from, prev_edge_from,
+                          pivot_weights.data() + pivot * vertex_count, pivot_prev_edges.data() + pivot * vertex_count,
+                          block_begin, block_end);
+            }
+        }
+    }
+
+    const auto relax_columns = [&](size_t columns_begin, size_t columns_end) {
+        for (size_t tile_begin = columns_begin; tile_begin < columns_end; tile_begin += COLUMNS_PER_TILE) {
+            const size_t tile_end = std::min(tile_begin + COLUMNS_PER_TILE, columns_end);
+            for (VertexId vertex_from = rows_begin; vertex_from < rows_end; ++vertex_from) {
+                if (block_begin <= vertex_from && vertex_from < block_end) {
+                    continue;
+                }
+                Weight* weights = routes_internal_data_.GetWeightsRow(vertex_from);
+                PrevEdge* prev_edges = routes_internal_data_.GetPrevEdgesRow(vertex_from);
+                const size_t from_offset = (vertex_from - rows_begin) * block_size;
+
+                for (size_t pivot = 0; pivot < block_size; ++pivot) {
+                    const Weight weight_from = weights_from[from_offset + pivot];
+                    if (weight_from != RoutesInternalData::UNREACHABLE) {
+                        relax_row(weights, prev_edges, weight_from, prev_edges_from[from_offset + pivot],
+                                  pivot_weights.data() + pivot * vertex_count,
+                                  pivot_prev_edges.data() + pivot * vertex_count,
+                                  tile_begin, tile_end);
+                    }
+                }
+            }
+        }
+    };
+    relax_columns(0, block_begin);
+    relax_columns(block_end, vertex_count);
+}
+
 template <typename Weight>
 Router<Weight>::Router(const Graph& graph, RoutesInternalData routes_data) :
     graph_(graph),
-    routes_internal_data_(move(routes_data)) {
+    routes_internal_data_(std::move(routes_data)) {
+    if (routes_internal_data_.GetVertexCount() != graph.GetVertexCount()) {
+        throw std::invalid_argument("Routes table does not match the graph");
+    }
+    // Таблица загружается из базы, а BuildRoute берёт ребро графа по каждому значению без проверки
+    const auto& prev_edges = routes_internal_data_.GetPrevEdges();
+    const bool has_unknown_edge = std::any_of(prev_edges.begin(), prev_edges.end(), [&graph](PrevEdge prev_edge) {
+        return prev_edge != RoutesInternalData::NO_EDGE && prev_edge >= graph.GetEdgeCount();
+    });
+    if (has_unknown_edge) {
+        throw std::invalid_argument("Routes table refers to an edge missing from the graph");
+    }
 }
 
 template <typename Weight>
 std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
                                                                              VertexId to) const {
-    const auto& route_internal_data = routes_internal_data_.at(from).at(to);
+    const auto route_internal_data = routes_internal_data_.Get(from, to);
     if (!route_internal_data) {
         return std::nullopt;
     }
     const Weight weight = route_internal_data->weight;
     std::vector<EdgeId> edges;
-    for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-         edge_id;
-         edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
-    {
-        edges.push_back(*edge_id);
-    }
+    ForEachRouteEdgeBackward(from, to, [&edges](EdgeId edge_id) {
+        edges.push_back(edge_id);
+    });
     std::reverse(edges.begin(), edges.end());
 
     return RouteInfo{weight, std::move(edges)};
 }
 
+template <typename Weight>
+template <typename Callback>
+void Router<Weight>::ForEachRouteEdgeBackward(VertexId from, VertexId to, Callback callback) const {
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    const PrevEdge* prev_edges = routes_internal_data_.GetPrevEdgesRow(from);
+    for (PrevEdge edge_id = prev_edges[to];
+         edge_id != RoutesInternalData::NO_EDGE;
+         edge_id = prev_edges[graph_.GetEdge(edge_id).from])
+    {
+        callback(static_cast<EdgeId>(edge_id));
+    }
+}
+
 }  // namespace graph
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Состояние одного поиска Дейкстры: веса, последние рёбра и двоичная куча.
+// Вершина считается достигнутой в текущем поиске, только если её метка совпадает
+// с номером поколения, поэтому между запросами массивы не нужно очищать целиком.
+// Weight — любой тип с операторами < и >, движки передают сюда ключ сравнения путей PathKey.
+template <typename Weight>
+struct SearchState {
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+    struct HeapEntry {
+        Weight weight;
+        VertexId vertex;
+
+        bool operator>(const HeapEntry& other) const {
+            return weight > other.weight;
+        }
+    };
+
+    explicit SearchState(size_t vertex_count)
+        : weights(vertex_count)
+        , prev_edges(vertex_count, NO_EDGE)
+        , marks(vertex_count, 0) {
+    }
+
+    void Reset() {
+        heap.clear();
+        if (++generation == 0) {
+            std::fill(marks.begin(), marks.end(), 0);
+            generation = 1;
+        }
+    }
+
+    bool IsReached(VertexId vertex) const {
+        return marks[vertex] == generation;
+    }
+
+    void Reach(VertexId vertex, Weight weight, EdgeId prev_edge) {
+        marks[vertex] = generation;
+        weights[vertex] = weight;
+        prev_edges[vertex] = prev_edge;
+    }
+
+    void Push(VertexId vertex, Weight weight) {
+        heap.push_back({weight, vertex});
+        std::push_heap(heap.begin(), heap.end(), std::greater<HeapEntry>{});
+    }
+
+    HeapEntry Pop() {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<HeapEntry>{});
+        const HeapEntry entry = heap.back();
+        heap.pop_back();
+        return entry;
+    }
+
+    const HeapEntry& Top() const {
+        return heap.front();
+    }
+
+    // Запись кучи устарела, если вершина уже достигнута с меньшим весом
+    bool IsStale(const HeapEntry& entry) const {
+        return weights[entry.vertex] < entry.weight;
+    }
+
+    std::vector<Weight> weights;
+    std::vector<EdgeId> prev_edges;
+    std::vector<uint32_t> marks;
+    uint32_t generation = 0;
+    std::vector<HeapEntry> heap;
+};
+
+// Выдаёт состояния поиска (любой тип, конструируемый из числа вершин) и переиспользует их
+// между запросами. Одновременные запросы из нескольких потоков получают разные состояния.
+template <typename State>
+class SearchStatePool {
+public:
+    explicit SearchStatePool(size_t vertex_count)
+        : vertex_count_(vertex_count) {
+    }
+
+    std::unique_ptr<State> Acquire() const {
+        {
+            std::lock_guard guard(mutex_);
+            if (!free_states_.empty()) {
+                auto state = std::move(free_states_.back());
+                free_states_.pop_back();
+                return state;
+            }
+        }
+        return std::make_unique<State>(vertex_count_);
+    }
+
+    void Release(std::unique_ptr<State> state) const {
+        std::lock_guard guard(mutex_);
+        free_states_.push_back(std::move(state));
+    }
+
+private:
+    const size_t vertex_count_;
+
+    mutable std::mutex mutex_;
+    mutable std::vector<std::unique_ptr<State>> free_states_;
+};
+
+}  // namespace graph
@@ -4,6 +4,8 @@
 #include "transport_catalogue.h"
 #include "graph.h"
 
+#include <stdexcept>
+
 using namespace std;
 
 namespace transport_catalogue_serialize {
@@ -43,33 +45,43 @@ optional<DeserializeResult> Deserialize(istream& input) {
 namespace details {
 
 TransportCatalogue Serialize(const transport_catalogue::TransportCatalogue& transport_catalogue) {
-    unordered_map<transport_catalogue::StopPtr, int> stop_to_id;
     TransportCatalogue object;
 
+    // Остановки и автобусы сохраняются в порядке номеров, поэтому номера в базе совпадают с ними
     StopList stop_list;
     for (const auto& stop : transport_catalogue.GetStopsRange()) {
-        stop_to_id[&stop] = stop_list.stop_size();
         *stop_list.add_stop() = Serialize(stop);
     }
 
-    for (const auto& [stops, length] : transport_catalogue.GetStopsDistanceRange()) {
-        const auto& [from, to] = stops;
-        auto& distance = *object.add_distance();
+    // Обратные направления восстанавливаются при загрузке, поэтому сохраняются только прямые
+    for (const auto& stop : transport_catalogue.GetStopsRange()) {
+        for (const auto& [to, is_reverse, length] : transport_catalogue.GetDistancesFrom(stop.id)) {
+            if (is_reverse) {
+                continue;
+            }
+            auto& distance = *object.add_distance();
 
-        distance.set_from_id(stop_to_id[from]);
-        distance.set_to_id(stop_to_id[to]);
-        distance.set_length(length);
+            distance.set_from_id(stop.id);
+            distance.set_to_id(to);
+            distance.set_length(length);
+        }
     }
 
     BusList bus_list;
     for (const auto& bus : transport_catalogue.GetBusesRange()) {
         auto object = Serialize(bus);
         for (auto* stop : bus.stops) {
-            object.add_stop_id(stop_to_id[stop]);
+            object.add_stop_id(stop->id);
         }
+        *object.mutable_stat() = Serialize(transport_catalogue.GetBusStat(bus.id));
         *bus_list.add_bus() = move(object);
     }
 
+    for (const auto& stop : transport_catalogue.GetStopsRange()) {
+        const auto& buses = transport_catalogue.GetBusesByStop(stop.id);
+        *object.add_stop_buses()->mutable_bus_id() = {buses.begin(), buses.end()};
+    }
+
     *object.mutable_stop_list() = move(stop_list);
     *object.mutable_bus_list() = move(bus_list);
     return object;
@@ -89,17 +101,15 @@ transport_catalogue::TransportCatalogue Deserialize(const TransportCatalogue& ob
             stop_raw.lng()
         }});
 
-        all_stops.push_back(&transport_catalogue.FindStop(stop_raw.name()));
+        all_stops.push_back(&transport_catalogue.GetStop(stop_id));
     }
 
     for (int i = 0; i < object.distance_size(); ++i) {
         auto& distance = object.distance(i);
-        auto& from = stop_list.stop(distance.from_id());
-        auto& to = stop_list.stop(distance.to_id());
 
         transport_catalogue.SetDistance(
-            transport_catalogue.FindStop(from.name()),
-            transport_catalogue.FindStop(to.name()),
+            *all_stops.at(distance.from_id()),
+            *all_stops.at(distance.to_id()),
             distance.length()
         );
     }
@@ -116,12 +126,27 @@ transport_catalogue::TransportCatalogue Deserialize(const TransportCatalogue& ob
             bus_stops.push_back(all_stops[bus.stop_id(stop_id)]);
         }
 
-        transport_catalogue.AddBus({
+        transport_catalogue::Bus new_bus{
             bus.name(),
             bus.is_roundtrip(),
             move(bus_stops)
-        });
+        };
+        if (bus.has_stat()) {
+            transport_catalogue.AddBus(new_bus, Deserialize(bus.stat()));
+        } else {
+            transport_catalogue.AddBus(new_bus);
+        }
+    }
+
+    if (object.stop_buses_size() == stop_list.stop_size()) {
+        vector<vector<transport_catalogue::BusId>> buses_by_stop;
+        buses_by_stop.reserve(object.stop_buses_size());
+        for (const auto& buses : object.stop_buses()) {
+            buses_by_stop.emplace_back(buses.bus_id().begin(), buses.bus_id().end());
+        }
+        transport_catalogue.SetBusesByStop(move(buses_by_stop));
     }
+    transport_catalogue.Finalize();
 
     return transport_catalogue;
 }
@@ -139,16 +164,46 @@ renderer::MapRenderer Deserialize(const MapRenderer& object) {
 TransportRouter Serialize(const transport_catalogue::TransportRouter& transport_router) {
     TransportRouter object;
     *object.mutable_routing_settings() = Serialize(transport_router.GetSettings());
-    *object.mutable_router() = Serialize(transport_router.GetRouter());
+    if (const auto* graph = transport_router.GetGraph()) {
+        *object.mutable_graph() = Serialize(*graph);
+        *object.mutable_route_items() = Serialize(transport_router.GetRouteItems());
+    }
+    if (const auto* router = transport_router.GetRouter()) {
+        *object.mutable_router() = Serialize(*router);
+    }
+    if (const auto* contraction_router = transport_router.GetContractionRouter()) {
+        *object.mutable_contraction_hierarchy() = Serialize(contraction_router->GetHierarchy());
+    }
+    if (const auto* astar_router = transport_router.GetAStarRouter()) {
+        *object.mutable_landmarks() = Serialize(astar_router->GetLandmarks());
+    }
     return object;
 }
 
 transport_catalogue::TransportRouter Deserialize(const TransportRouter& object, const transport_catalogue::TransportCatalogue& transport_catalogue) {
-    auto router_data = Deserialize(object.router());
+    transport_catalogue::TransportRouter::EngineData engine_data;
+    if (object.has_router()) {
+        engine_data.routes = Deserialize(object.router());
+    }
+    if (object.has_contraction_hierarchy()) {
+        engine_data.hierarchy = Deserialize(object.contraction_hierarchy());
+    }
+    if (object.has_landmarks()) {
+        engine_data.landmarks = Deserialize(object.landmarks());
+    }
+
+    optional<transport_catalogue::TransportRouter::RoutingGraph> routing_graph;
+    if (object.has_graph()) {
+        routing_graph = {
+            Deserialize(object.graph()),
+            Deserialize(object.route_items(), transport_catalogue)
+        };
+    }
 
     return {
         Deserialize(object.routing_settings()),
-        move(router_data),
+        move(routing_graph),
+        move(engine_data),
         transport_catalogue,
     };
 }
@@ -172,6 +227,26 @@ Bus Serialize(const transport_catalogue::Bus& bus) {
     return object;
 }
 
+BusStat Serialize(const transport_catalogue::BusStat& bus_stat) {
+    BusStat object;
+
+    object.set_stop_count(bus_stat.stops_amount);
+    object.set_unique_stop_count(bus_stat.unique_stops_amount);
+    object.set_route_length(bus_stat.route_length);
+    object.set_curvature(bus_stat.curvature);
+
+    return object;
+}
+
+transport_catalogue::BusStat Deserialize(const BusStat& object) {
+    return {
+        object.stop_count(),
+        object.unique_stop_count(),
+        object.route_length(),
+        object.curvature()
+    };
+}
+
 RenderSettings Serialize(const renderer::RenderSettings& render_settings) {
     RenderSettings object;
 
@@ -226,6 +301,9 @@ RoutingSettings Serialize(const transport_catalogue::RoutingSettings& routing_se
 
     object.set_bus_wait_time(routing_settings.bus_wait_time);
     object.set_bus_velocity(routing_settings.bus_velocity);
+    object.set_engine(Serialize(routing_settings.engine));
+    object.set_collapse_wait_edges(routing_settings.collapse_wait_edges);
+    object.set_landmark_count(routing_settings.landmark_count);
 
     return object;
 }
@@ -235,67 +313,181 @@ transport_catalogue::RoutingSettings Deserialize(const RoutingSettings& object)
 
     routing_settings.bus_wait_time = object.bus_wait_time();
     routing_settings.bus_velocity = object.bus_velocity();
+    routing_settings.engine = Deserialize(object.engine());
+    routing_settings.collapse_wait_edges = object.collapse_wait_edges();
+    routing_settings.landmark_count = object.landmark_count();
 
     return routing_settings;
 }
 
-Router Serialize(const transport_catalogue::TransportRouter::Router& router) {
-    Router object;
+RouterEngine Serialize(transport_catalogue::RouterEngine engine) {
+    switch (engine) {
+        case transport_catalogue::RouterEngine::Dijkstra:
+            return RouterEngine::DIJKSTRA;
+        case transport_catalogue::RouterEngine::ContractionHierarchies:
+            return RouterEngine::CONTRACTION_HIERARCHIES;
+        case transport_catalogue::RouterEngine::Raptor:
+            return RouterEngine::RAPTOR;
+        case transport_catalogue::RouterEngine::AStar:
+            return RouterEngine::ASTAR;
+        case transport_catalogue::RouterEngine::BidirectionalDijkstra:
+            return RouterEngine::BIDIRECTIONAL_DIJKSTRA;
+        default:
+            return RouterEngine::ALL_PAIRS;
+    }
+}
 
-    for (const auto& routes : router.GetRoutesRange()) {
-        auto& route_list = *object.add_route_list();
+transport_catalogue::RouterEngine Deserialize(RouterEngine object) {
+    switch (object) {
+        case RouterEngine::DIJKSTRA:
+            return transport_catalogue::RouterEngine::Dijkstra;
+        case RouterEngine::CONTRACTION_HIERARCHIES:
+            return transport_catalogue::RouterEngine::ContractionHierarchies;
+        case RouterEngine::RAPTOR:
+            return transport_catalogue::RouterEngine::Raptor;
+        case RouterEngine::ASTAR:
+            return transport_catalogue::RouterEngine::AStar;
+        case RouterEngine::BIDIRECTIONAL_DIJKSTRA:
+            return transport_catalogue::RouterEngine::BidirectionalDijkstra;
+        default:
+            return transport_catalogue::RouterEngine::AllPairs;
+    }
+}
 
-        for (const auto& route : routes) {
-            auto& route_object = *route_list.add_route();
+Graph Serialize(const transport_catalogue::TransportRouter::Graph& graph) {
+    Graph object;
 
-            if (route) {
-                RouteData data;
-                data.set_weight(route->weight);
+    object.set_vertex_count(graph.GetVertexCount());
+    for (const auto& edge : graph.GetEdges()) {
+        object.add_edge_from(edge.from);
+        object.add_edge_to(edge.to);
+        object.add_edge_weight(edge.weight);
+    }
 
-                if (route->prev_edge) {
-                    EdgeId edge_id;
-                    edge_id.set_id(*route->prev_edge);
-                    *data.mutable_prev_edge() = move(edge_id);
-                }
+    return object;
+}
 
-                *route_object.mutable_data() = move(data);
-            }
-        }
+transport_catalogue::TransportRouter::Graph Deserialize(const Graph& object) {
+    vector<graph::Edge<double>> edges;
+    edges.reserve(object.edge_from_size());
+
+    for (int i = 0; i < object.edge_from_size(); ++i) {
+        edges.push_back({object.edge_from(i), object.edge_to(i), object.edge_weight(i)});
+    }
+
+    return {object.vertex_count(), move(edges)};
+}
+
+RouteItems Serialize(const vector<transport_catalogue::RouteItemDesc>& route_items) {
+    RouteItems object;
+    for (const auto& item : route_items) {
+        object.add_stop_id(item.stop ? static_cast<int>(item.stop->id) : -1);
+        object.add_bus_id(item.bus ? static_cast<int>(item.bus->id) : -1);
+        object.add_span_count(item.span_count);
+        object.add_time(item.time);
     }
 
     return object;
 }
 
-transport_catalogue::TransportRouter::Router::RoutesInternalData Deserialize(const Router& object) {
-    using RouteInternalData = transport_catalogue::TransportRouter::Router::RouteInternalData;
-    using RoutesInternalData = transport_catalogue::TransportRouter::Router::RoutesInternalData;
+vector<transport_catalogue::RouteItemDesc> Deserialize(const RouteItems& object,
+                                                       const transport_catalogue::TransportCatalogue& transport_catalogue) {
+    vector<transport_catalogue::RouteItemDesc> route_items;
+    route_items.reserve(object.stop_id_size());
+
+    for (int i = 0; i < object.stop_id_size(); ++i) {
+        const int stop_id = object.stop_id(i);
+        const int bus_id = object.bus_id(i);
+        // -1 означает, что ссылки нет, другие номера должны указывать на объекты справочника
+        if (stop_id < -1 || (stop_id >= 0 && static_cast<size_t>(stop_id) >= transport_catalogue.GetStopsCount())) {
+            throw invalid_argument("Route item refers to a stop missing from the catalogue");
+        }
+        if (bus_id < -1 || (bus_id >= 0 && static_cast<size_t>(bus_id) >= transport_catalogue.GetBusesCount())) {
+            throw invalid_argument("Route item refers to a bus missing from the catalogue");
+        }
 
-    int vertex_count = object.route_list_size();
-    RoutesInternalData data(vertex_count, vector<optional<RouteInternalData>>(vertex_count));
+        route_items.push_back({
+            bus_id < 0 ? transport_catalogue::RouteItemType::Wait : transport_catalogue::RouteItemType::Bus,
+            stop_id < 0 ? nullptr : &transport_catalogue.GetStop(stop_id),
+            bus_id < 0 ? nullptr : &transport_catalogue.GetBus(bus_id),
+            object.span_count(i),
+            object.time(i)
+        });
+    }
 
-    for (int from_id = 0; from_id < vertex_count; ++from_id) {
-        const auto& route_list = object.route_list(from_id);
+    return route_items;
+}
 
-        for (int to_id = 0; to_id < route_list.route_size(); ++to_id) {
-            const auto& route = route_list.route(to_id);
+ContractionHierarchy Serialize(const transport_catalogue::TransportRouter::ContractionRouter::Hierarchy& hierarchy) {
+    ContractionHierarchy object;
 
-            if (route.has_data()) {
-                const auto& route_data = route.data();
-                optional<graph::EdgeId> prev_edge;
+    *object.mutable_rank() = {hierarchy.ranks.begin(), hierarchy.ranks.end()};
+    for (const auto& shortcut : hierarchy.shortcuts) {
+        object.add_shortcut_from(shortcut.from);
+        object.add_shortcut_to(shortcut.to);
+        object.add_shortcut_weight(shortcut.weight);
+        object.add_shortcut_first_edge(shortcut.first_edge);
+        object.add_shortcut_second_edge(shortcut.second_edge);
+    }
 
-                if (route_data.has_prev_edge()) {
-                    prev_edge = route_data.prev_edge().id();
-                }
+    return object;
+}
 
-                data[from_id][to_id] = {
-                    route_data.weight(),
-                    prev_edge
-                };
-            }
-        }
+transport_catalogue::TransportRouter::ContractionRouter::Hierarchy Deserialize(const ContractionHierarchy& object) {
+    transport_catalogue::TransportRouter::ContractionRouter::Hierarchy hierarchy;
+
+    hierarchy.ranks = {object.rank().begin(), object.rank().end()};
+    hierarchy.shortcuts.reserve(object.shortcut_from_size());
+    for (int i = 0; i < object.shortcut_from_size(); ++i) {
+        hierarchy.shortcuts.push_back({
+            object.shortcut_from(i),
+            object.shortcut_to(i),
+            object.shortcut_weight(i),
+            object.shortcut_first_edge(i),
+            object.shortcut_second_edge(i)
+        });
     }
 
-    return data;
+    return hierarchy;
+}
+
+Landmarks Serialize(const transport_catalogue::TransportRouter::AStarRouter::Landmarks& landmarks) {
+    Landmarks object;
+
+    *object.mutable_vertex() = {landmarks.vertices.begin(), landmarks.vertices.end()};
+    *object.mutable_distance_from() = {landmarks.distances_from.begin(), landmarks.distances_from.end()};
+    *object.mutable_distance_to() = {landmarks.distances_to.begin(), landmarks.distances_to.end()};
+
+    return object;
+}
+
+transport_catalogue::TransportRouter::AStarRouter::Landmarks Deserialize(const Landmarks& object) {
+    return {
+        {object.vertex().begin(), object.vertex().end()},
+        {object.distance_from().begin(), object.distance_from().end()},
+        {object.distance_to().begin(), object.distance_to().end()}
+    };
+}
+
+Router Serialize(const transport_catalogue::TransportRouter::Router& router) {
+    Router object;
+    const auto& data = router.GetRoutesInternalData();
+
+    object.set_vertex_count(data.GetVertexCount());
+    *object.mutable_weight() = {data.GetWeights().begin(), data.GetWeights().end()};
+    *object.mutable_prev_edge() = {data.GetPrevEdges().begin(), data.GetPrevEdges().end()};
+
+    return object;
+}
+
+transport_catalogue::TransportRouter::Router::RoutesInternalData Deserialize(const Router& object) {
+    using RoutesInternalData = transport_catalogue::TransportRouter::Router::RoutesInternalData;
+
+    return RoutesInternalData(
+        object.vertex_count(),
+        {object.weight().begin(), object.weight().end()},
+        {object.prev_edge().begin(), object.prev_edge().end()}
+    );
 }
 
 Point Serialize(const svg::Point& point) {
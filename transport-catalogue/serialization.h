@@ -6,6 +6,7 @@
 
 #include <iostream>
 #include <optional>
+#include <vector>
 #include <transport_catalogue.pb.h>
 
 namespace transport_catalogue_serialize {
@@ -36,12 +37,31 @@ transport_catalogue::TransportRouter Deserialize(const TransportRouter& object,
 Stop Serialize(const transport_catalogue::Stop& stop);
 Bus Serialize(const transport_catalogue::Bus& bus);
 
+BusStat Serialize(const transport_catalogue::BusStat& bus_stat);
+transport_catalogue::BusStat Deserialize(const BusStat& object);
+
 RenderSettings Serialize(const renderer::RenderSettings& render_settings);
 renderer::RenderSettings Deserialize(const RenderSettings& object);
 
 RoutingSettings Serialize(const transport_catalogue::RoutingSettings& routing_settings);
 transport_catalogue::RoutingSettings Deserialize(const RoutingSettings& object);
 
+RouterEngine Serialize(transport_catalogue::RouterEngine engine);
+transport_catalogue::RouterEngine Deserialize(RouterEngine object);
+
+Graph Serialize(const transport_catalogue::TransportRouter::Graph& graph);
+transport_catalogue::TransportRouter::Graph Deserialize(const Graph& object);
+
+RouteItems Serialize(const std::vector<transport_catalogue::RouteItemDesc>& route_items);
+std::vector<transport_catalogue::RouteItemDesc> Deserialize(const RouteItems& object,
+                                                            const transport_catalogue::TransportCatalogue& transport_catalogue);
+
+ContractionHierarchy Serialize(const transport_catalogue::TransportRouter::ContractionRouter::Hierarchy& hierarchy);
+transport_catalogue::TransportRouter::ContractionRouter::Hierarchy Deserialize(const ContractionHierarchy& object);
+
+Landmarks Serialize(const transport_catalogue::TransportRouter::AStarRouter::Landmarks& landmarks);
+transport_catalogue::TransportRouter::AStarRouter::Landmarks Deserialize(const Landmarks& object);
+
 Router Serialize(const transport_catalogue::TransportRouter::Router& router);
 transport_catalogue::TransportRouter::Router::RoutesInternalData Deserialize(const Router& object);
 
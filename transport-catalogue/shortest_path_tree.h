@@ -0,0 +1,188 @@
+#pragma once
+
+#include "graph.h"
+#include "path_key.h"
+#include "router.h"
+#include "search_state.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Дерево кратчайших путей из одной вершины, построенное поиском Дейкстры.
+// Поиск можно ограничить: он заканчивается, как только извлечены все вершины targets,
+// или как только вес вершины кучи превысил max_weight. Вес и маршрут известны только
+// для извлечённых из кучи (окончательных) вершин. Пути сравниваются по ключу PathKey, как у DijkstraRouter,
+// поэтому маршруты дерева совпадают с маршрутами остальных движков.
+// Буферы поиска берутся из пула на время жизни дерева, поэтому дерево стоит памяти
+// и времени только на просмотренные вершины, а не на весь граф
+template <typename Weight>
+class ShortestPathTree {
+public:
+    using Graph = DirectedWeightedGraph<Weight>;
+    using RouteInfo = typename Router<Weight>::RouteInfo;
+
+    struct Limits {
+        // Пустой список — без ограничения по вершинам
+        std::vector<VertexId> targets;
+        std::optional<Weight> max_weight;
+    };
+
+    // Состояние поиска и метки окончательных вершин и целей. Метка действительна, только если
+    // совпадает с поколением состояния поиска, поэтому между деревьями буферы не очищаются
+    struct Buffers {
+        explicit Buffers(size_t vertex_count)
+            : search(vertex_count)
+            , settled_marks(vertex_count, 0)
+            , target_marks(vertex_count, 0) {
+        }
+
+        SearchState<PathKey<Weight>> search;
+        std::vector<uint32_t> settled_marks;
+        std::vector<uint32_t> target_marks;
+    };
+
+    using BuffersPool = SearchStatePool<Buffers>;
+
+    // Стоимости выбора индексируются номером ребра
+    ShortestPathTree(const Graph& graph, const std::vector<TieCost>& tie_costs, const BuffersPool& buffers_pool,
+                     VertexId from, const Limits& limits = {});
+
+    ShortestPathTree(const ShortestPathTree&) = delete;
+    ShortestPathTree& operator=(const ShortestPathTree&) = delete;
+
+    ~ShortestPathTree();
+
+    std::optional<Weight> GetWeight(VertexId to) const;
+
+    std::optional<RouteInfo> BuildRoute(VertexId to) const;
+
+    // Окончательные вершины в порядке извлечения, то есть по неубыванию веса
+    const std::vector<VertexId>& GetSettledVertices() const;
+
+private:
+    using Key = PathKey<Weight>;
+    using State = SearchState<Key>;
+
+    bool IsSettled(VertexId vertex) const;
+
+    const Graph& graph_;
+    const BuffersPool& buffers_pool_;
+    std::unique_ptr<Buffers> buffers_;
+    std::vector<VertexId> settled_vertices_;
+};
+
+template <typename Weight>
+ShortestPathTree<Weight>::ShortestPathTree(const Graph& graph, const std::vector<TieCost>& tie_costs,
+                                           const BuffersPool& buffers_pool, VertexId from, const Limits& limits)
+    : graph_(graph)
+    , buffers_pool_(buffers_pool)
+{
+    if (tie_costs.size() != graph.GetEdgeCount()) {
+        throw std::invalid_argument("Tie costs do not match edge count");
+    }
+    if (from >= graph.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    for (const VertexId target : limits.targets) {
+        if (target >= graph.GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+    }
+
+    buffers_ = buffers_pool_.Acquire();
+    auto& state = buffers_->search;
+    state.Reset();
+    // Поколения начались заново, и метки прошлых поколений могли бы совпасть с новыми
+    if (state.generation == 1) {
+        std::fill(buffers_->settled_marks.begin(), buffers_->settled_marks.end(), 0);
+        std::fill(buffers_->target_marks.begin(), buffers_->target_marks.end(), 0);
+    }
+
+    size_t remaining_targets = 0;
+    for (const VertexId target : limits.targets) {
+        if (buffers_->target_marks[target] != state.generation) {
+            buffers_->target_marks[target] = state.generation;
+            ++remaining_targets;
+        }
+    }
+
+    state.Reach(from, {}, State::NO_EDGE);
+    state.Push(from, {});
+
+    while (!state.heap.empty()) {
+        const auto entry = state.Pop();
+        if (state.IsStale(entry)) {
+            continue;
+        }
+        if (limits.max_weight && *limits.max_weight < entry.weight.weight) {
+            break;
+        }
+
+        buffers_->settled_marks[entry.vertex] = state.generation;
+        settled_vertices_.push_back(entry.vertex);
+        if (buffers_->target_marks[entry.vertex] == state.generation && --remaining_targets == 0) {
+            break;
+        }
+
+        for (const EdgeId edge_id : graph_.GetIncidentEdges(entry.vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const Key candidate_key = entry.weight + Key{edge.weight, tie_costs[edge_id]};
+            if (!state.IsReached(edge.to) || candidate_key < state.weights[edge.to]) {
+                state.Reach(edge.to, candidate_key, edge_id);
+                state.Push(edge.to, candidate_key);
+            }
+        }
+    }
+}
+
+template <typename Weight>
+ShortestPathTree<Weight>::~ShortestPathTree() {
+    buffers_pool_.Release(std::move(buffers_));
+}
+
+template <typename Weight>
+bool ShortestPathTree<Weight>::IsSettled(VertexId vertex) const {
+    if (vertex >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    return buffers_->settled_marks[vertex] == buffers_->search.generation;
+}
+
+template <typename Weight>
+std::optional<Weight> ShortestPathTree<Weight>::GetWeight(VertexId to) const {
+    if (!IsSettled(to)) {
+        return std::nullopt;
+    }
+    return buffers_->search.weights[to].weight;
+}
+
+template <typename Weight>
+std::optional<typename ShortestPathTree<Weight>::RouteInfo> ShortestPathTree<Weight>::BuildRoute(VertexId to) const {
+    if (!IsSettled(to)) {
+        return std::nullopt;
+    }
+
+    const auto& state = buffers_->search;
+    std::vector<EdgeId> edges;
+    for (EdgeId edge_id = state.prev_edges[to]; edge_id != State::NO_EDGE;
+         edge_id = state.prev_edges[graph_.GetEdge(edge_id).from])
+    {
+        edges.push_back(edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+    return RouteInfo{state.weights[to].weight, std::move(edges)};
+}
+
+template <typename Weight>
+const std::vector<VertexId>& ShortestPathTree<Weight>::GetSettledVertices() const {
+    return settled_vertices_;
+}
+
+}  // namespace graph
@@ -0,0 +1,263 @@
+#include "json_reader.h"
+#include "map_renderer.h"
+#include "random_city.h"
+#include "serialization.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Сравнивает ответы всех движков маршрутизации на одной базе. Для каждой пары остановок
+// маршрут должен находиться у всех движков тот же, что и у таблицы всех пар: с теми же элементами
+// и тем же временем в пути. Элементы маршрута должны складываться в это время, а матрица маршрутов
+// (времена и числа перегонов) и достижимые остановки — совпадать с маршрутами.
+// Каждая база проходит сохранение и загрузку, как между make_base и process_requests.
+// Проверяются база из файла, переданного первым аргументом, и случайные базы с фиксированными зёрнами
+
+using namespace std;
+using namespace transport_catalogue;
+
+namespace {
+
+constexpr double TIME_TOLERANCE = 1e-9;
+constexpr double REACHABLE_MAX_TIME = 20.0;
+
+const vector<pair<string, RouterEngine>> ENGINES = {
+    {"all_pairs"s, RouterEngine::AllPairs},
+    {"dijkstra"s, RouterEngine::Dijkstra},
+    {"contraction_hierarchies"s, RouterEngine::ContractionHierarchies},
+    {"raptor"s, RouterEngine::Raptor},
+    {"astar"s, RouterEngine::AStar},
+    {"bidirectional_dijkstra"s, RouterEngine::BidirectionalDijkstra}
+};
+
+// Элемент маршрута с именами вместо указателей: у разных баз это разные объекты справочника.
+// У элемента Wait сравнивается остановка, у элемента Bus — автобус
+struct Item {
+    RouteItemType type;
+    string name;
+    int span_count;
+    double time;
+};
+
+struct Route {
+    double total_time;
+    vector<Item> items;
+};
+
+// Маршрут для каждой пары остановок построчно, пустая ячейка — маршрута нет
+using RouteTable = vector<optional<Route>>;
+
+void Assert(bool condition, const string& message) {
+    if (!condition) {
+        throw runtime_error(message);
+    }
+}
+
+bool AreTimesEqual(double lhs, double rhs) {
+    return abs(lhs - rhs) <= TIME_TOLERANCE * max(1.0, abs(lhs));
+}
+
+void CheckRouteItems(const TransportRouter::RouteResult& route, const string& context) {
+    double items_time = 0.0;
+    for (const auto& item : route.second) {
+        if (item.type == RouteItemType::Wait) {
+            Assert(item.stop != nullptr, context + ": wait item has no stop"s);
+        } else {
+            Assert(item.bus != nullptr && item.span_count > 0, context + ": bus item has no bus or spans"s);
+        }
+        items_time += item.time;
+    }
+    Assert(AreTimesEqual(items_time, route.first), context + ": items do not add up to the total time"s);
+}
+
+Route MakeRoute(const TransportRouter::RouteResult& route) {
+    Route result{route.first, {}};
+    for (const auto& item : route.second) {
+        const string& name = item.type == RouteItemType::Wait ? item.stop->name : item.bus->name;
+        result.items.push_back({item.type, name, item.span_count, item.time});
+    }
+    return result;
+}
+
+int CountSpans(const Route& route) {
+    int span_count = 0;
+    for (const auto& item : route.items) {
+        span_count += item.span_count;
+    }
+    return span_count;
+}
+
+RouteTable BuildRouteTable(const TransportCatalogue& catalogue, const TransportRouter& router, const string& context) {
+    vector<StopPtr> stops;
+    for (const auto& stop : catalogue.GetStopsRange()) {
+        stops.push_back(&stop);
+    }
+    const auto matrix = router.BuildRouteMatrix(stops, stops, true);
+
+    RouteTable routes;
+    for (const StopPtr from : stops) {
+        for (const StopPtr to : stops) {
+            const string route_context = context + ", "s + from->name + " -> "s + to->name;
+            const auto route = router.BuildRoute(*from, *to);
+            const size_t cell = routes.size();
+
+            Assert(static_cast<bool>(route) == matrix.total_times[cell].has_value(),
+                   route_context + ": route matrix disagrees"s);
+            if (!route) {
+                routes.push_back(nullopt);
+                continue;
+            }
+            CheckRouteItems(*route, route_context);
+            routes.push_back(MakeRoute(*route));
+            Assert(AreTimesEqual(route->first, *matrix.total_times[cell]), route_context + ": route matrix time differs"s);
+            Assert(CountSpans(*routes.back()) == matrix.span_counts[cell],
+                   route_context + ": route matrix span count differs"s);
+        }
+    }
+    return routes;
+}
+
+void CompareRoutes(const Route& route, const Route& expected, const string& context) {
+    Assert(AreTimesEqual(route.total_time, expected.total_time), context + ": total time differs"s);
+    Assert(route.items.size() == expected.items.size(), context + ": item count differs"s);
+    for (size_t i = 0; i < route.items.size(); ++i) {
+        const auto& item = route.items[i];
+        const auto& expected_item = expected.items[i];
+        const string item_context = context + ", item "s + to_string(i);
+        Assert(item.type == expected_item.type && item.name == expected_item.name
+               && item.span_count == expected_item.span_count, item_context + ": item differs"s);
+        Assert(AreTimesEqual(item.time, expected_item.time), item_context + ": item time differs"s);
+    }
+}
+
+// Остановки, достижимые из каждой остановки не дольше чем за REACHABLE_MAX_TIME, должны совпадать
+// с остановками, маршрут до которых не дольше этого времени. Остановки на самой границе пропускаются:
+// время до них у разных движков может отличаться в пределах погрешности
+void CheckReachableStops(const TransportCatalogue& catalogue, const TransportRouter& router, const RouteTable& routes,
+                         const string& context) {
+    const size_t stop_count = catalogue.GetStopsCount();
+    for (const auto& from : catalogue.GetStopsRange()) {
+        vector<optional<double>> reachable_times(stop_count);
+        for (const auto& [stop, time] : router.FindReachableStops(from, REACHABLE_MAX_TIME)) {
+            reachable_times[stop->id] = time;
+        }
+
+        for (const auto& to : catalogue.GetStopsRange()) {
+            const string pair_context = context + ", reachable from "s + from.name + " to "s + to.name;
+            const auto& route = routes[from.id * stop_count + to.id];
+            if (route && AreTimesEqual(route->total_time, REACHABLE_MAX_TIME)) {
+                continue;
+            }
+            const bool is_reachable = route && route->total_time <= REACHABLE_MAX_TIME;
+            Assert(reachable_times[to.id].has_value() == is_reachable, pair_context + ": reachability differs"s);
+            if (is_reachable) {
+                Assert(AreTimesEqual(*reachable_times[to.id], route->total_time), pair_context + ": time differs"s);
+            }
+        }
+    }
+}
+
+// Строит маршрутизатор выбранного движка, сохраняет базу и возвращает загруженную из неё
+transport_catalogue_serialize::DeserializeResult SaveAndLoad(const TransportCatalogue& catalogue,
+                                                             const renderer::RenderSettings& render_settings,
+                                                             RoutingSettings routing_settings) {
+    const renderer::MapRenderer map_renderer(render_settings);
+    const TransportRouter transport_router(move(routing_settings), catalogue);
+
+    stringstream stream;
+    transport_catalogue_serialize::Serialize(catalogue, map_renderer, transport_router, stream);
+    auto result = transport_catalogue_serialize::Deserialize(stream);
+    Assert(result.has_value(), "Saved base can not be loaded"s);
+    return move(*result);
+}
+
+void CompareEngines(const string& base_name, const TransportCatalogue& catalogue,
+                    const renderer::RenderSettings& render_settings, const RoutingSettings& routing_settings) {
+    optional<RouteTable> expected_routes;
+    for (const auto& [engine_name, engine] : ENGINES) {
+        const string context = base_name + ", "s + engine_name;
+        RoutingSettings settings = routing_settings;
+        settings.engine = engine;
+
+        const auto base = SaveAndLoad(catalogue, render_settings, settings);
+        const auto routes = BuildRouteTable(base.transport_catalogue, base.route_manager, context);
+        CheckReachableStops(base.transport_catalogue, base.route_manager, routes, context);
+        if (!expected_routes) {
+            expected_routes = routes;
+            continue;
+        }
+
+        Assert(routes.size() == expected_routes->size(), context + ": stop count differs"s);
+        for (size_t i = 0; i < routes.size(); ++i) {
+            const string cell_context = context + ", pair "s + to_string(i);
+            Assert(routes[i].has_value() == (*expected_routes)[i].has_value(), cell_context + ": reachability differs"s);
+            if (routes[i]) {
+                CompareRoutes(*routes[i], *(*expected_routes)[i], cell_context);
+            }
+        }
+    }
+}
+
+void TestBaseFromFile(const string& path) {
+    ifstream input(path);
+    Assert(input.good(), "Can not open "s + path);
+
+    TransportCatalogue catalogue;
+    const auto document = ParseBaseDocument(catalogue, json::ReadAll(input));
+    CompareEngines(path, catalogue, ParseRenderSettings(document), ParseRoutingSettings(document));
+}
+
+void TestRandomBase() {
+    TransportCatalogue catalogue;
+    tests::FillRandomCity(catalogue, 2024, 60, 20);
+
+    // Отрисовка не проверяется, но цвет подложки нужен, чтобы сохранить базу
+    renderer::RenderSettings render_settings;
+    render_settings.underlayer_color = "white"s;
+    CompareEngines("random base"s, catalogue, render_settings, {6.0, 40.0});
+
+    RoutingSettings collapsed_settings{6.0, 40.0};
+    collapsed_settings.collapse_wait_edges = true;
+    CompareEngines("random base with collapsed wait edges"s, catalogue, render_settings, collapsed_settings);
+}
+
+// Расстояния кратны километру, поэтому у многих пар остановок несколько маршрутов равного времени
+// и движки должны одинаково выбирать между ними
+void TestTiedRandomBase() {
+    TransportCatalogue catalogue;
+    tests::FillRandomCity(catalogue, 2026, 60, 30, 1000);
+
+    renderer::RenderSettings render_settings;
+    render_settings.underlayer_color = "white"s;
+    CompareEngines("random base with tied routes"s, catalogue, render_settings, {6.0, 40.0});
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        cerr << "Usage: engines_test make_base.json\n"s;
+        return 1;
+    }
+
+    try {
+        TestBaseFromFile(argv[1]);
+        TestRandomBase();
+        TestTiedRandomBase();
+    } catch (const exception& e) {
+        cerr << e.what() << '\n';
+        return 1;
+    }
+    cerr << "All router engines agree\n"s;
+    return 0;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "domain.h"
+#include "transport_catalogue.h"
+
+#include <cstddef>
+#include <random>
+#include <string>
+
+namespace tests {
+
+// Заполняет справочник остановками в квадрате около 10 км со стороной и автобусами по случайным остановкам.
+// Расстояния по дорогам округляются вверх до кратных distance_step метрам: чем крупнее шаг, тем чаще встречаются маршруты,
+// равные по времени. Один и тот же seed даёт один и тот же город при любом шаге
+inline void FillRandomCity(transport_catalogue::TransportCatalogue& catalogue, unsigned seed,
+                           size_t stop_count, size_t bus_count, int distance_step = 1) {
+    using namespace std::string_literals;
+
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> coordinate(0.0, 0.1);
+    std::uniform_int_distribution<size_t> stop_index(0, stop_count - 1);
+    std::uniform_int_distribution<size_t> bus_length(2, 8);
+    std::uniform_int_distribution<int> distance(300, 3000);
+    std::bernoulli_distribution coin(0.5);
+    const auto road_distance = [&] {
+        return (distance(generator) + distance_step - 1) / distance_step * distance_step;
+    };
+
+    for (size_t i = 0; i < stop_count; ++i) {
+        catalogue.AddStop({"Stop "s + std::to_string(i), {55.5 + coordinate(generator), 37.5 + coordinate(generator)}});
+    }
+
+    for (size_t i = 0; i < bus_count; ++i) {
+        transport_catalogue::Bus bus{"Bus "s + std::to_string(i), coin(generator), {}};
+        const size_t length = bus_length(generator);
+        while (bus.stops.size() < length) {
+            bus.stops.push_back(&catalogue.GetStop(stop_index(generator)));
+        }
+        if (bus.is_roundtrip) {
+            bus.stops.push_back(bus.stops.front());
+        }
+
+        // В обратную сторону расстояние задаётся не всегда, тогда используется прямое
+        for (size_t j = 1; j < bus.stops.size(); ++j) {
+            catalogue.SetDistance(*bus.stops[j - 1], *bus.stops[j], road_distance());
+            if (coin(generator)) {
+                catalogue.SetDistance(*bus.stops[j], *bus.stops[j - 1], road_distance());
+            }
+        }
+        catalogue.AddBus(bus);
+    }
+    catalogue.Finalize();
+}
+
+}  // namespace tests
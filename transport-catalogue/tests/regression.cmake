@@ -0,0 +1,24 @@
+# Запускает make_base и process_requests на эталонном вводе из TEST_DIR в каталоге WORK_DIR
+# и сравнивает ответы с expected_output.json.
+# Параметры: TRANSPORT_CATALOGUE — путь к программе, TEST_DIR, WORK_DIR
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+foreach(MODE make_base process_requests)
+    execute_process(
+        COMMAND ${TRANSPORT_CATALOGUE} ${MODE}
+        WORKING_DIRECTORY ${WORK_DIR}
+        INPUT_FILE ${TEST_DIR}/${MODE}.json
+        OUTPUT_FILE ${WORK_DIR}/${MODE}_output.json
+        RESULT_VARIABLE RESULT)
+    if(NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "${MODE} failed: ${RESULT}")
+    endif()
+endforeach()
+
+execute_process(
+    COMMAND ${CMAKE_COMMAND} -E compare_files ${WORK_DIR}/process_requests_output.json ${TEST_DIR}/expected_output.json
+    RESULT_VARIABLE RESULT)
+if(NOT RESULT EQUAL 0)
+    message(FATAL_ERROR "Output ${WORK_DIR}/process_requests_output.json differs from ${TEST_DIR}/expected_output.json")
+endif()
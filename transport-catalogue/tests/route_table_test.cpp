@@ -0,0 +1,153 @@
+#include "random_city.h"
+#include "relax_kernel.h"
+#include "router.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Проверяет, что таблица маршрутов всех пар не зависит от параметров предподсчёта:
+// таблицы, посчитанные на случайном городе в одном и в нескольких потоках, а также скалярным
+// и векторными ядрами релаксации, должны совпадать побайтово. Ядра, которые процессор
+// не поддерживает, пропускаются
+
+using namespace std;
+using namespace transport_catalogue;
+
+namespace {
+
+// Несколько блоков и задач Floyd–Warshall, чтобы потоки действительно делили работу
+constexpr size_t STOP_COUNT = 150;
+constexpr size_t BUS_COUNT = 60;
+constexpr size_t THREAD_COUNT = 4;
+
+const RoutingSettings ROUTING_SETTINGS = {6.0, 40.0};
+
+const vector<pair<string, graph::RelaxKernel>> VECTOR_KERNELS = {
+    {"sse4"s, graph::RelaxKernel::Sse4},
+    {"avx2"s, graph::RelaxKernel::Avx2}
+};
+
+// Длина строк для проверки ядер отдельно от таблицы: несколько векторов и хвост
+constexpr size_t ROW_SIZE = 37;
+
+using RoutesInternalData = TransportRouter::Router::RoutesInternalData;
+
+void Assert(bool condition, const string& message) {
+    if (!condition) {
+        throw runtime_error(message);
+    }
+}
+
+const RoutesInternalData& GetRoutesTable(const TransportRouter& transport_router) {
+    return transport_router.GetRouter()->GetRoutesInternalData();
+}
+
+void AssertTablesEqual(const RoutesInternalData& expected, const RoutesInternalData& actual, const string& context) {
+    const auto& expected_weights = expected.GetWeights();
+    const auto& actual_weights = actual.GetWeights();
+    Assert(expected_weights.size() == actual_weights.size(), context + ": table size differs"s);
+    Assert(memcmp(expected_weights.data(), actual_weights.data(), expected_weights.size() * sizeof(double)) == 0,
+           context + ": weights differ"s);
+    Assert(expected.GetPrevEdges() == actual.GetPrevEdges(), context + ": previous edges differ"s);
+}
+
+void TestThreadCount(const TransportCatalogue& catalogue) {
+    const TransportRouter serial(ROUTING_SETTINGS, catalogue, {1});
+    const TransportRouter parallel(ROUTING_SETTINGS, catalogue, {THREAD_COUNT});
+    AssertTablesEqual(GetRoutesTable(serial), GetRoutesTable(parallel), to_string(THREAD_COUNT) + " threads"s);
+}
+
+void TestRelaxKernels(const TransportCatalogue& catalogue) {
+    const TransportRouter scalar(ROUTING_SETTINGS, catalogue, {1, graph::RelaxKernel::Scalar});
+    for (const auto& [name, kernel] : VECTOR_KERNELS) {
+        if (!graph::IsRelaxKernelSupported(kernel)) {
+            cerr << name << " kernel is not supported, skipped\n"s;
+            continue;
+        }
+        const TransportRouter vectorized(ROUTING_SETTINGS, catalogue, {1, kernel});
+        AssertTablesEqual(GetRoutesTable(scalar), GetRoutesTable(vectorized), name + " kernel"s);
+    }
+}
+
+// Релаксирует одни и те же строки скалярным и векторными ядрами на всех отрезках [begin, end)
+// с началом в первых векторах. Веса берутся из нескольких значений, чтобы встречались равные кандидаты,
+// часть ячеек недостижима, часть не имеет последнего ребра
+void TestRelaxRows() {
+    constexpr double UNREACHABLE = numeric_limits<double>::infinity();
+
+    mt19937 generator(2026);
+    uniform_int_distribution<int> small_weight(0, 6);
+    uniform_int_distribution<uint32_t> edge(0, 1000);
+    bernoulli_distribution rare(0.2);
+
+    const auto make_weights = [&] {
+        vector<double> weights(ROW_SIZE);
+        for (double& weight : weights) {
+            weight = rare(generator) ? UNREACHABLE : small_weight(generator) * 1.5;
+        }
+        return weights;
+    };
+    const auto make_prev_edges = [&] {
+        vector<uint32_t> prev_edges(ROW_SIZE);
+        for (uint32_t& prev_edge : prev_edges) {
+            prev_edge = rare(generator) ? graph::NO_PREV_EDGE : edge(generator);
+        }
+        return prev_edges;
+    };
+
+    const auto weights = make_weights();
+    const auto prev_edges = make_prev_edges();
+    const auto weights_through = make_weights();
+    const auto prev_edges_through = make_prev_edges();
+    const double weight_from = 3.0;
+    const uint32_t prev_edge_from = 7;
+
+    const auto relax = [&](graph::RelaxKernel kernel, size_t begin, size_t end) {
+        pair result(weights, prev_edges);
+        graph::GetRelaxRowFunction(kernel)(result.first.data(), result.second.data(), weight_from, prev_edge_from,
+                                           weights_through.data(), prev_edges_through.data(), begin, end);
+        return result;
+    };
+
+    for (const auto& [name, kernel] : VECTOR_KERNELS) {
+        if (!graph::IsRelaxKernelSupported(kernel)) {
+            continue;
+        }
+        for (size_t begin = 0; begin <= 8; ++begin) {
+            for (size_t end = begin; end <= ROW_SIZE; ++end) {
+                const string context = name + " kernel, cells ["s + to_string(begin) + ", "s + to_string(end) + ")"s;
+                const auto expected = relax(graph::RelaxKernel::Scalar, begin, end);
+                const auto actual = relax(kernel, begin, end);
+                Assert(memcmp(expected.first.data(), actual.first.data(), ROW_SIZE * sizeof(double)) == 0,
+                       context + ": weights differ"s);
+                Assert(expected.second == actual.second, context + ": previous edges differ"s);
+            }
+        }
+    }
+}
+
+}  // namespace
+
+int main() {
+    try {
+        TransportCatalogue catalogue;
+        tests::FillRandomCity(catalogue, 2025, STOP_COUNT, BUS_COUNT);
+        TestThreadCount(catalogue);
+        TestRelaxKernels(catalogue);
+        TestRelaxRows();
+    } catch (const exception& e) {
+        cerr << e.what() << '\n';
+        return 1;
+    }
+    cerr << "Route tables match\n"s;
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace concurrency {
+
+using namespace std;
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    const size_t worker_count = max<size_t>(thread_count, 1) - 1;
+    workers_.reserve(worker_count);
+    for (size_t i = 0; i < worker_count; ++i) {
+        workers_.emplace_back([this] {
+            WorkerLoop();
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard guard(mutex_);
+        stopping_ = true;
+    }
+    task_ready_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::GetThreadCount() const {
+    return workers_.size() + 1;
+}
+
+void ThreadPool::Run(size_t count, const function<void(size_t)>& task) {
+    if (workers_.empty() || count <= 1) {
+        for (size_t index = 0; index < count; ++index) {
+            task(index);
+        }
+        return;
+    }
+
+    lock_guard run_guard(run_mutex_);
+    {
+        lock_guard guard(mutex_);
+        task_ = &task;
+        task_size_ = count;
+        next_index_ = 0;
+        error_ = nullptr;
+        active_workers_ = workers_.size();
+        ++generation_;
+    }
+    task_ready_.notify_all();
+
+    ExecuteTask();
+
+    unique_lock lock(mutex_);
+    task_done_.wait(lock, [this] {
+        return active_workers_ == 0;
+    });
+    task_ = nullptr;
+    if (error_) {
+        rethrow_exception(exchange(error_, nullptr));
+    }
+}
+
+void ThreadPool::WorkerLoop() {
+    size_t seen_generation = 0;
+    while (true) {
+        {
+            unique_lock lock(mutex_);
+            task_ready_.wait(lock, [this, seen_generation] {
+                return stopping_ || generation_ != seen_generation;
+            });
+            if (stopping_) {
+                return;
+            }
+            seen_generation = generation_;
+        }
+
+        ExecuteTask();
+
+        lock_guard guard(mutex_);
+        if (--active_workers_ == 0) {
+            task_done_.notify_one();
+        }
+    }
+}
+
+void ThreadPool::ExecuteTask() {
+    for (size_t index = next_index_++; index < task_size_; index = next_index_++) {
+        try {
+            (*task_)(index);
+        } catch (...) {
+            lock_guard guard(mutex_);
+            if (!error_) {
+                error_ = current_exception();
+            }
+            next_index_ = task_size_;
+        }
+    }
+}
+
+} // namespace concurrency
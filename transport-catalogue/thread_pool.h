@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace concurrency {
+
+// Пул потоков фиксированного размера для параллельных циклов.
+// Вызывающий поток тоже участвует в работе, поэтому пул на один поток
+// не создаёт ни одного дополнительного потока и выполняет задачи последовательно.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t thread_count);
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool();
+
+    size_t GetThreadCount() const;
+
+    // Вызывает task(index) для каждого index из [0, count) и дожидается завершения всех вызовов.
+    // Первое выброшенное задачей исключение пробрасывается вызывающему потоку.
+    template <typename Task>
+    void ParallelFor(size_t count, Task&& task) {
+        Run(count, std::function<void(size_t)>(std::forward<Task>(task)));
+    }
+
+private:
+    void Run(size_t count, const std::function<void(size_t)>& task);
+
+    void WorkerLoop();
+
+    void ExecuteTask();
+
+    std::vector<std::thread> workers_;
+
+    std::mutex run_mutex_;
+
+    std::mutex mutex_;
+    std::condition_variable task_ready_;
+    std::condition_variable task_done_;
+
+    const std::function<void(size_t)>* task_ = nullptr;
+    size_t task_size_ = 0;
+    std::atomic<size_t> next_index_{0};
+    size_t generation_ = 0;
+    size_t active_workers_ = 0;
+    bool stopping_ = false;
+    std::exception_ptr error_;
+};
+
+} // namespace concurrency
@@ -5,7 +5,8 @@
 #include <numeric>
 #include <algorithm>
 #include <optional>
-#include <unordered_set>
+#include <stdexcept>
+#include <string>
 #include <tuple>
 #include <utility>
 
@@ -17,23 +18,44 @@ void TransportCatalogue::AddStop(const Stop& stop) {
     stops_.push_back(move(stop));
 
     auto* ptr_stop = &stops_.back();
+    ptr_stop->id = static_cast<StopId>(stops_.size() - 1);
 
     stop_by_name_[ptr_stop->name] = ptr_stop;
-    stop_to_buses_.insert({ptr_stop, {}});
+    buses_by_stop_.emplace_back();
 }
 
 const Stop& TransportCatalogue::FindStop(string_view name) const {
     return *stop_by_name_.at(name);
 }
 
+bool TransportCatalogue::HasStop(string_view name) const {
+    return stop_by_name_.count(name) > 0;
+}
+
+const Stop& TransportCatalogue::GetStop(StopId id) const {
+    return stops_[id];
+}
+
+// Повторный проход автобуса через остановку виден по последнему элементу её списка
 void TransportCatalogue::AddBus(const Bus& bus) {
     buses_.push_back(move(bus));
-    const auto* ptr_bus = &buses_.back();
+    auto* ptr_bus = &buses_.back();
+    ptr_bus->id = static_cast<BusId>(buses_.size() - 1);
 
     bus_by_name_[ptr_bus->name] = ptr_bus;
     for (const auto* stop : ptr_bus->stops) {
-        stop_to_buses_[stop].insert(ptr_bus);
+        auto& buses = buses_by_stop_[stop->id];
+        if (buses.empty() || buses.back() != ptr_bus->id) {
+            buses.push_back(ptr_bus->id);
+        }
     }
+    are_buses_by_stop_sorted_ = false;
+    bus_stats_.emplace_back();
+}
+
+void TransportCatalogue::AddBus(const Bus& bus, const BusStat& stat) {
+    AddBus(bus);
+    bus_stats_.back() = stat;
 }
 
 BusPtr TransportCatalogue::FindBus(string_view name) const {
@@ -43,53 +65,182 @@ BusPtr TransportCatalogue::FindBus(string_view name) const {
     return bus_by_name_.at(name);
 }
 
+const Bus& TransportCatalogue::GetBus(BusId id) const {
+    return buses_[id];
+}
+
 optional<BusStat> TransportCatalogue::GetBusStat(string_view bus_name) const {
     if (const auto bus = FindBus(bus_name)) {
-        const vector<StopPtr> stops = MakeRoute(bus);
-        unordered_set<StopPtr> unique_stops(stops.begin(), stops.end());
-
-        auto coord_distance = transform_reduce(
-                next(stops.begin()), stops.end(),
-                stops.begin(),
-                0.0,
-                plus<>{},
-                [](const auto* curr, const auto* prev){
-                    return geo::ComputeDistance(prev->coordinates, curr->coordinates);
-                });
-
-        auto distance = transform_reduce(
-                next(stops.begin()), stops.end(),
-                stops.begin(),
-                0.0,
-                plus<>{},
-                [this](const auto* curr, const auto* prev){
-                    return GetDistance(*prev, *curr);
-                });
-
-        return optional<BusStat>{{stops.size(), unique_stops.size(), distance, distance / coord_distance}};
+        return GetBusStat(bus->id);
     }
 
     return nullopt;
 }
 
-const std::unordered_set<BusPtr>* TransportCatalogue::GetBusesByStop(string_view name) const {
+const BusStat& TransportCatalogue::GetBusStat(BusId id) const {
+    return bus_stats_[id].value();
+}
+
+BusStat TransportCatalogue::ComputeBusStat(const Bus& bus) const {
+    const vector<StopPtr> stops = MakeRoute(bus);
+    if (stops.empty()) {
+        return {0, 0, 0.0, 0.0};
+    }
+
+    vector<StopId> stop_ids;
+    stop_ids.reserve(stops.size());
+    for (const auto* stop : stops) {
+        stop_ids.push_back(stop->id);
+    }
+    sort(stop_ids.begin(), stop_ids.end());
+    const size_t unique_stops_amount = unique(stop_ids.begin(), stop_ids.end()) - stop_ids.begin();
+
+    auto coord_distance = transform_reduce(
+            next(stops.begin()), stops.end(),
+            stops.begin(),
+            0.0,
+            plus<>{},
+            [](const auto* curr, const auto* prev){
+                return geo::ComputeDistance(prev->coordinates, curr->coordinates);
+            });
+
+    auto distance = transform_reduce(
+            next(stops.begin()), stops.end(),
+            stops.begin(),
+            0.0,
+            plus<>{},
+            [this](const auto* curr, const auto* prev){
+                return GetDistance(*prev, *curr);
+            });
+
+    return {stops.size(), unique_stops_amount, distance, distance / coord_distance};
+}
+
+const vector<BusId>* TransportCatalogue::GetBusesByStop(string_view name) const {
     if (stop_by_name_.count(name) == 0) {
         return nullptr;
     }
 
-    return &stop_to_buses_.at(&FindStop(name));
+    return &GetBusesByStop(FindStop(name).id);
+}
+
+const vector<BusId>& TransportCatalogue::GetBusesByStop(StopId id) const {
+    return buses_by_stop_[id];
+}
+
+void TransportCatalogue::SetBusesByStop(vector<vector<BusId>> buses_by_stop) {
+    if (buses_by_stop.size() != stops_.size()) {
+        throw invalid_argument("Bus lists do not match stops"s);
+    }
+    buses_by_stop_ = move(buses_by_stop);
+    are_buses_by_stop_sorted_ = true;
 }
 
 void TransportCatalogue::SetDistance(const Stop& from, const Stop& to, double distance) {
-    stops_to_distance_[make_pair(&from, &to)] = distance;
+    // Статистика, посчитанная по прежней таблице, устарела
+    if (!distance_offsets_.empty()) {
+        bus_stats_.assign(bus_stats_.size(), nullopt);
+    }
+    added_distances_.push_back({{from.id, to.id}, distance});
 }
 
+// У остановки обычно несколько соседей, поэтому линейный просмотр быстрее двоичного поиска
 double TransportCatalogue::GetDistance(const Stop& from, const Stop& to) const {
-    auto stops_pair = make_pair(&from, &to);
-    if (stops_to_distance_.count(stops_pair) == 0) {
-        return stops_to_distance_.at(make_pair(&to, &from));
+    for (const auto& distance : GetDistancesFrom(from.id)) {
+        if (distance.to == to.id) {
+            return distance.length;
+        }
     }
-    return stops_to_distance_.at(stops_pair);
+    throw out_of_range("Distance between '"s + from.name + "' and '"s + to.name + "' is not set"s);
+}
+
+void TransportCatalogue::Finalize() {
+    BuildDistanceTable();
+    BuildBusStats();
+    if (!are_buses_by_stop_sorted_) {
+        SortBusesByStop();
+    }
+}
+
+// Статистика, загруженная вместе с автобусом, не пересчитывается
+void TransportCatalogue::BuildBusStats() {
+    for (const auto& bus : buses_) {
+        if (!bus_stats_[bus.id]) {
+            bus_stats_[bus.id] = ComputeBusStat(bus);
+        }
+    }
+}
+
+// Ответ на запрос Stop выводит названия автобусов по алфавиту и без повторов,
+// поэтому списки упорядочиваются один раз здесь, а не при каждом запросе
+void TransportCatalogue::SortBusesByStop() {
+    const auto get_name = [this](BusId id) -> const string& {
+        return buses_[id].name;
+    };
+
+    for (auto& buses : buses_by_stop_) {
+        sort(buses.begin(), buses.end(), [&get_name](BusId lhs, BusId rhs) {
+            return get_name(lhs) < get_name(rhs);
+        });
+        buses.erase(unique(buses.begin(), buses.end(), [&get_name](BusId lhs, BusId rhs) {
+            return get_name(lhs) == get_name(rhs);
+        }), buses.end());
+    }
+    are_buses_by_stop_sorted_ = true;
+}
+
+ranges::Range<vector<TransportCatalogue::RoadDistance>::const_iterator> TransportCatalogue::GetDistancesFrom(StopId id) const {
+    if (distance_offsets_.size() != stops_.size() + 1 || !added_distances_.empty()) {
+        throw logic_error("Catalogue is not finalized"s);
+    }
+    return {distances_.begin() + distance_offsets_[id], distances_.begin() + distance_offsets_[id + 1]};
+}
+
+// Каждое новое расстояние добавляется и в обратную сторону с пометкой, а из записей для одной пары
+// остаётся прямая, заданная последней, иначе обратная, заданная последней. Записи уже построенной
+// таблицы считаются заданными раньше новых, поэтому повторное построение даёт то же, что и построение
+// по всем расстояниям сразу. Поиск не проверяет оба направления и возвращает то же, что прежде
+// возвращала хеш-таблица
+void TransportCatalogue::BuildDistanceTable() {
+    struct Entry {
+        StopId from;
+        StopId to;
+        bool is_reverse;
+        size_t order;
+        double length;
+    };
+
+    vector<Entry> entries;
+    entries.reserve(distances_.size() + added_distances_.size() * 2);
+    for (StopId from = 0; from + 1 < distance_offsets_.size(); ++from) {
+        for (auto index = distance_offsets_[from]; index < distance_offsets_[from + 1]; ++index) {
+            const auto& distance = distances_[index];
+            entries.push_back({from, distance.to, distance.is_reverse, 0, distance.length});
+        }
+    }
+    for (size_t order = 0; order < added_distances_.size(); ++order) {
+        const auto& [stops, length] = added_distances_[order];
+        entries.push_back({stops.first, stops.second, false, order + 1, length});
+        entries.push_back({stops.second, stops.first, true, order + 1, length});
+    }
+    added_distances_ = {};
+
+    sort(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs) {
+        return tie(lhs.from, lhs.to, lhs.is_reverse, rhs.order) < tie(rhs.from, rhs.to, rhs.is_reverse, lhs.order);
+    });
+
+    distance_offsets_.assign(stops_.size() + 1, 0);
+    distances_.clear();
+    for (size_t index = 0; index < entries.size(); ++index) {
+        const auto& entry = entries[index];
+        if (index > 0 && entry.from == entries[index - 1].from && entry.to == entries[index - 1].to) {
+            continue;
+        }
+        distances_.push_back({entry.to, entry.is_reverse, entry.length});
+        ++distance_offsets_[entry.from + 1];
+    }
+    distances_.shrink_to_fit();
+    partial_sum(distance_offsets_.begin(), distance_offsets_.end(), distance_offsets_.begin());
 }
 
 size_t TransportCatalogue::GetBusesCount() const {
@@ -107,8 +258,4 @@ ranges::Range<std::deque<Stop>::const_iterator> TransportCatalogue::GetStopsRang
 ranges::Range<std::deque<Bus>::const_iterator> TransportCatalogue::GetBusesRange() const {
     return ranges::AsRange(buses_);
 }
-
-ranges::Range<TransportCatalogue::StopDistancesMap::const_iterator> TransportCatalogue::GetStopsDistanceRange() const {
-    return ranges::AsRange(stops_to_distance_);
-}
 } // namespace transport_catalogue
@@ -2,32 +2,40 @@
 
 #include "domain.h"
 #include "ranges.h"
+#include <cstdint>
 #include <optional>
 #include <string_view>
 #include <deque>
+#include <vector>
 #include <unordered_map>
 #include <map>
-#include <unordered_set>
 #include <iostream>
 
 namespace transport_catalogue {
 
+// Пара номеров остановок укладывается в одно 64-битное число без коллизий
 struct StopsPairHasher {
-    std::size_t operator()(const std::pair<StopPtr, StopPtr>& stops_pair) const {
-        return ptr_hasher(stops_pair.first) * 37 + ptr_hasher(stops_pair.second);
+    std::size_t operator()(const std::pair<StopId, StopId>& stops_pair) const {
+        return hasher(static_cast<std::uint64_t>(stops_pair.first) << 32 | stops_pair.second);
     }
 
 private:
-    std::hash<const void*> ptr_hasher;
+    std::hash<std::uint64_t> hasher;
 };
 
 class TransportCatalogue {
 public:
     using StopIndexMap = std::unordered_map<std::string_view, StopPtr>;
     using BusIndexMap = std::map<std::string_view, BusPtr>;
-    using StopBusesIndexMap = std::unordered_map<StopPtr, std::unordered_set<BusPtr>>;
-    using StopsPair = std::pair<StopPtr, StopPtr>;
-    using StopDistancesMap = std::unordered_map<StopsPair, double, StopsPairHasher>;
+    using StopsPair = std::pair<StopId, StopId>;
+
+    // Расстояние по дорогам до соседней остановки
+    struct RoadDistance {
+        StopId to;
+        // Расстояние задано только в обратную сторону, из to
+        bool is_reverse;
+        double length;
+    };
 
     auto begin() const {
         return bus_by_name_.begin();
@@ -41,18 +49,50 @@ public:
 
     const Stop& FindStop(std::string_view name) const;
 
+    bool HasStop(std::string_view name) const;
+
+    const Stop& GetStop(StopId id) const;
+
     void AddBus(const Bus& bus);
 
+    // Добавляет автобус с уже посчитанной статистикой маршрута, например загруженной из базы
+    void AddBus(const Bus& bus, const BusStat& stat);
+
     BusPtr FindBus(std::string_view name) const;
 
+    const Bus& GetBus(BusId id) const;
+
+    // Статистика маршрута считается один раз в Finalize, поэтому запрос выполняется за O(1)
     std::optional<BusStat> GetBusStat(std::string_view bus_name) const;
 
-    const std::unordered_set<BusPtr>* GetBusesByStop(std::string_view name) const;
+    const BusStat& GetBusStat(BusId id) const;
+
+    // Номера автобусов, проходящих через остановку, после Finalize упорядочены по названиям
+    // без повторов. nullptr, если остановки нет
+    const std::vector<BusId>* GetBusesByStop(std::string_view name) const;
+
+    const std::vector<BusId>& GetBusesByStop(StopId id) const;
+
+    // Заменяет списки автобусов всех остановок уже упорядоченными, например загруженными из базы
+    void SetBusesByStop(std::vector<std::vector<BusId>> buses_by_stop);
 
+    // Повторный вызов для той же пары остановок заменяет расстояние. Расстояние, заданное
+    // после Finalize, учитывается при следующем вызове Finalize, а до него чтение расстояний —
+    // ошибка. Статистика маршрутов при этом пересчитывается
     void SetDistance(const Stop& from, const Stop& to, double distance);
 
+    // Расстояние из from в to, а если оно не задано — из to в from.
+    // Выбрасывает std::out_of_range, если не задано ни то, ни другое
     double GetDistance(const Stop& from, const Stop& to) const;
 
+    // Строит индексы для запросов. Вызывается после добавления всех остановок, автобусов
+    // и расстояний и до первого запроса. Повторный вызов дополняет индексы добавленным с тех пор
+    void Finalize();
+
+    // Расстояния из остановки по возрастанию номеров соседей, включая заданные только в обратную сторону.
+    // Выбрасывает std::logic_error, если после добавления остановок или расстояний не вызван Finalize
+    ranges::Range<std::vector<RoadDistance>::const_iterator> GetDistancesFrom(StopId id) const;
+
     size_t GetBusesCount() const;
 
     size_t GetStopsCount() const;
@@ -61,17 +101,32 @@ public:
 
     ranges::Range<std::deque<Bus>::const_iterator> GetBusesRange() const;
 
-    ranges::Range<StopDistancesMap::const_iterator> GetStopsDistanceRange() const;
-
 private:
     std::deque<Stop> stops_;
     StopIndexMap stop_by_name_;
 
     std::deque<Bus> buses_;
     BusIndexMap bus_by_name_;
+    // Индексируется номером автобуса. Пусто, пока статистика не посчитана в Finalize
+    std::vector<std::optional<BusStat>> bus_stats_;
+
+    // Индексируется номером остановки
+    std::vector<std::vector<BusId>> buses_by_stop_;
+    bool are_buses_by_stop_sorted_ = false;
+    // Расстояния, заданные после последнего вызова Finalize, в порядке задания
+    std::vector<std::pair<StopsPair, double>> added_distances_;
+    // Таблица расстояний в формате CSR: расстояния из остановки id занимают
+    // [distance_offsets_[id], distance_offsets_[id + 1]) в distances_
+    std::vector<std::uint32_t> distance_offsets_;
+    std::vector<RoadDistance> distances_;
+
+    void BuildDistanceTable();
+
+    void BuildBusStats();
+
+    void SortBusesByStop();
 
-    StopBusesIndexMap stop_to_buses_;
-    StopDistancesMap stops_to_distance_;
+    BusStat ComputeBusStat(const Bus& bus) const;
 };
 
 } // namespace transport_catalogue
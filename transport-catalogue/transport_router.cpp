@@ -1,7 +1,13 @@
 #include "transport_router.h"
 #include "graph.h"
 #include "router.h"
+#include "dijkstra_router.h"
+#include "geo.h"
 
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
 #include <utility>
 
 namespace transport_catalogue {
@@ -9,106 +15,524 @@ namespace transport_catalogue {
 using namespace std;
 using namespace graph;
 
-TransportRouter::TransportRouter(RoutingSettings settings, const TransportCatalogue& transport_catalogue) :
-    settings_(move(settings)),
-    graph_(make_unique<Graph>(transport_catalogue.GetStopsCount() * 2)) {
+TransportRouter::TransportRouter(RoutingSettings settings, const TransportCatalogue& transport_catalogue,
+                                 const PrecomputeSettings& precompute_settings) :
+    settings_(move(settings)) {
 
-    FillGraphWithStops(transport_catalogue);
-    FillGraphWithBuses(transport_catalogue);
+    if (UsesGraph()) {
+        BuildGraph(transport_catalogue);
+    }
 
-    router_ = make_unique<graph::Router<double>>(*graph_);
+    InitializeRouter(transport_catalogue, {}, precompute_settings);
 }
 
 TransportRouter::TransportRouter(
         RoutingSettings settings,
-        TransportRouter::Router::RoutesInternalData router_data,
+        optional<RoutingGraph> routing_graph,
+        EngineData engine_data,
         const TransportCatalogue& transport_catalogue) :
-    settings_(move(settings)),
-    graph_(make_unique<Graph>(transport_catalogue.GetStopsCount() * 2)) {
+    settings_(move(settings)) {
+
+    if (UsesGraph()) {
+        if (!routing_graph) {
+            throw invalid_argument("Routing graph is required by the router engine");
+        }
+        if (routing_graph->graph.GetVertexCount() != GetVertexCount(transport_catalogue)) {
+            throw invalid_argument("Routing graph vertex count does not match the catalogue");
+        }
+        if (routing_graph->route_items.size() != routing_graph->graph.GetEdgeCount()) {
+            throw invalid_argument("Route items count does not match the routing graph edge count");
+        }
+
+        IndexStops(transport_catalogue);
+        graph_ = make_unique<Graph>(move(routing_graph->graph));
+        route_items_by_edges_ = move(routing_graph->route_items);
+    }
+
+    InitializeRouter(transport_catalogue, move(engine_data));
+}
+
+TransportRouter::RouteResultPtr TransportRouter::BuildRoute(const Stop& from, const Stop& to) const {
+    const auto key = make_pair(from.id, to.id);
+    if (auto cached = route_cache_->Get(key)) {
+        return move(*cached);
+    }
+
+    auto result = ComputeRoute(from, to);
+    route_cache_->Put(key, result);
+    return result;
+}
+
+vector<TransportRouter::RouteResultPtr> TransportRouter::BuildRoutes(const Stop& from, const vector<StopPtr>& to) const {
+    vector<RouteResultPtr> results(to.size());
+
+    vector<size_t> missed_indices;
+    for (size_t index = 0; index < to.size(); ++index) {
+        if (auto cached = route_cache_->Get(make_pair(from.id, to[index]->id))) {
+            results[index] = move(*cached);
+        } else {
+            missed_indices.push_back(index);
+        }
+    }
+
+    // Поиск до одной вершины повторяет шаги построения дерева до извлечения этой вершины,
+    // а путь к извлечённой вершине дальше не меняется, поэтому маршруты дерева совпадают с BuildRoute
+    if (settings_.engine != RouterEngine::Dijkstra || missed_indices.size() < MIN_SHARED_SEARCH_TARGETS) {
+        for (const size_t index : missed_indices) {
+            results[index] = ComputeRoute(from, *to[index]);
+        }
+    } else {
+        vector<VertexId> targets;
+        targets.reserve(missed_indices.size());
+        for (const size_t index : missed_indices) {
+            targets.push_back(vertices_by_stop_[to[index]->id].first);
+        }
+
+        const ShortestPathTree tree(*graph_, *edge_tie_costs_, *tree_buffers_, vertices_by_stop_[from.id].first,
+                                    {targets, nullopt});
+        for (size_t i = 0; i < missed_indices.size(); ++i) {
+            const auto route = tree.BuildRoute(targets[i]);
+            results[missed_indices[i]] = route ? MakeRouteResult(*route) : nullptr;
+        }
+    }
+
+    for (const size_t index : missed_indices) {
+        route_cache_->Put(make_pair(from.id, to[index]->id), results[index]);
+    }
+    return results;
+}
+
+void TransportRouter::SetRouteCacheCapacity(size_t capacity) {
+    route_cache_ = make_unique<RouteCache>(capacity);
+}
+
+cache::CacheStats TransportRouter::GetRouteCacheStats() const {
+    return route_cache_->GetStats();
+}
+
+TransportRouter::RouteResultPtr TransportRouter::ComputeRoute(const Stop& from, const Stop& to) const {
+    if (!UsesGraph()) {
+        return ComputeRaptorRoute(from, to);
+    }
+
+    auto from_id = vertices_by_stop_[from.id].first;
+    auto to_id = vertices_by_stop_[to.id].first;
+
+    auto route = FindRoute(from_id, to_id);
 
-    FillGraphWithStops(transport_catalogue);
-    FillGraphWithBuses(transport_catalogue);
+    return route ? MakeRouteResult(*route) : nullptr;
+}
+
+TransportRouter::RouteResultPtr TransportRouter::MakeRouteResult(const Router::RouteInfo& route) const {
+    vector<RouteItemDesc> items;
+    items.reserve(route.edges.size() * (settings_.collapse_wait_edges ? 2 : 1));
+
+    for (const auto& edgeId : route.edges) {
+        const auto& item = route_items_by_edges_[edgeId];
+        if (settings_.collapse_wait_edges) {
+            items.push_back({RouteItemType::Wait, item.stop, nullptr, 0, settings_.bus_wait_time});
+        }
+        items.push_back(item);
+    }
 
-    router_ = make_unique<Router>(*graph_, router_data);
+    return make_shared<const RouteResult>(route.weight, move(items));
 }
 
-optional<TransportRouter::RouteResult> TransportRouter::BuildRoute(const Stop& from, const Stop& to) const {
-    auto from_id = vertices_by_stop_.at(&from).first;
-    auto to_id = vertices_by_stop_.at(&to).first;
+TransportRouter::RouteResultPtr TransportRouter::ComputeRaptorRoute(const Stop& from, const Stop& to) const {
+    const auto journey = raptor_router_->BuildRoute(from, to);
+    if (!journey) {
+        return nullptr;
+    }
+
+    vector<RouteItemDesc> items;
+    items.reserve(journey->legs.size() * 2);
+    for (const auto& leg : journey->legs) {
+        items.push_back({RouteItemType::Wait, leg.boarding_stop, nullptr, 0, settings_.bus_wait_time});
+        items.push_back({RouteItemType::Bus, nullptr, leg.bus, leg.span_count, leg.time});
+    }
+
+    return make_shared<const RouteResult>(journey->total_time, move(items));
+}
+
+TransportRouter::RouteMatrix TransportRouter::BuildRouteMatrix(const vector<StopPtr>& from, const vector<StopPtr>& to,
+                                                               bool with_span_counts) const {
+    RouteMatrix matrix;
+    matrix.column_count = to.size();
+    matrix.total_times.reserve(from.size() * to.size());
+    if (with_span_counts) {
+        matrix.span_counts.reserve(from.size() * to.size());
+    }
+
+    // RAPTOR находит прибытия на все остановки to одним поиском из каждой остановки from.
+    // Ячейки не проходят через кеш ответов: в нём лежат маршруты с элементами, а матрице нужны только времена
+    if (!UsesGraph()) {
+        for (const auto* from_stop : from) {
+            for (const auto& arrival : raptor_router_->FindArrivals(*from_stop, to)) {
+                matrix.total_times.push_back(arrival ? optional(arrival->total_time) : nullopt);
+                if (with_span_counts) {
+                    matrix.span_counts.push_back(arrival ? arrival->span_count : 0);
+                }
+            }
+        }
+        return matrix;
+    }
+
+    vector<VertexId> targets;
+    targets.reserve(to.size());
+    for (const auto* to_stop : to) {
+        targets.push_back(vertices_by_stop_[to_stop->id].first);
+    }
 
-    if (auto route = router_->BuildRoute(from_id, to_id)) {
-        vector<RouteItemDesc> items;
-        items.reserve(route->edges.size());
+    for (const auto* from_stop : from) {
+        const VertexId source = vertices_by_stop_[from_stop->id].first;
 
-        for (const auto& edgeId : route->edges) {
-            items.push_back(route_items_by_edges_.at(edgeId));
+        if (router_) {
+            for (const VertexId target : targets) {
+                const auto route_data = router_->GetRoutesInternalData().Get(source, target);
+                matrix.total_times.push_back(route_data ? optional(route_data->weight) : nullopt);
+                if (with_span_counts) {
+                    int span_count = 0;
+                    router_->ForEachRouteEdgeBackward(source, target, [&](EdgeId edge_id) {
+                        span_count += route_items_by_edges_[edge_id].span_count;
+                    });
+                    matrix.span_counts.push_back(span_count);
+                }
+            }
+            continue;
         }
 
-        return make_pair(route->weight, move(items));
+        const ShortestPathTree tree(*graph_, *edge_tie_costs_, *tree_buffers_, source, {targets, nullopt});
+        for (const VertexId target : targets) {
+            matrix.total_times.push_back(tree.GetWeight(target));
+            if (with_span_counts) {
+                const auto route = tree.BuildRoute(target);
+                matrix.span_counts.push_back(route ? CountSpans(route->edges) : 0);
+            }
+        }
     }
 
-    return nullopt;
+    return matrix;
+}
+
+vector<TransportRouter::ReachableStop> TransportRouter::FindReachableStops(const Stop& from, double max_time) const {
+    vector<ReachableStop> reachable_stops;
+
+    if (!UsesGraph()) {
+        for (const auto& [stop, time] : raptor_router_->FindReachableStops(from, max_time)) {
+            reachable_stops.push_back({stop, time});
+        }
+    } else {
+        const ShortestPathTree tree(*graph_, *edge_tie_costs_, *tree_buffers_, vertices_by_stop_[from.id].first,
+                                    {{}, max_time});
+        for (const VertexId vertex : tree.GetSettledVertices()) {
+            if (const StopPtr stop = stops_by_vertex_[vertex]) {
+                reachable_stops.push_back({stop, *tree.GetWeight(vertex)});
+            }
+        }
+    }
+
+    sort(reachable_stops.begin(), reachable_stops.end(), [](const ReachableStop& lhs, const ReachableStop& rhs) {
+        return pair(lhs.time, string_view(lhs.stop->name)) < pair(rhs.time, string_view(rhs.stop->name));
+    });
+    return reachable_stops;
+}
+
+int TransportRouter::CountSpans(const vector<EdgeId>& edges) const {
+    int span_count = 0;
+    for (const EdgeId edge_id : edges) {
+        span_count += route_items_by_edges_[edge_id].span_count;
+    }
+    return span_count;
 }
 
 const RoutingSettings& TransportRouter::GetSettings() const {
     return settings_;
 }
 
-const TransportRouter::Router& TransportRouter::GetRouter() const {
-    return *router_;
+const TransportRouter::Router* TransportRouter::GetRouter() const {
+    return router_.get();
+}
+
+const TransportRouter::ContractionRouter* TransportRouter::GetContractionRouter() const {
+    return contraction_router_.get();
+}
+
+optional<TransportRouter::Router::RouteInfo> TransportRouter::FindRoute(VertexId from, VertexId to) const {
+    switch (settings_.engine) {
+        case RouterEngine::Dijkstra:
+            return dijkstra_router_->BuildRoute(from, to);
+        case RouterEngine::BidirectionalDijkstra:
+            return bidirectional_dijkstra_router_->BuildRoute(from, to);
+        case RouterEngine::ContractionHierarchies:
+            return contraction_router_->BuildRoute(from, to);
+        case RouterEngine::AStar:
+            return astar_router_->BuildRoute(from, to);
+        default:
+            return router_->BuildRoute(from, to);
+    }
+}
+
+const TransportRouter::AStarRouter* TransportRouter::GetAStarRouter() const {
+    return astar_router_.get();
+}
+
+bool TransportRouter::UsesGraph() const {
+    return settings_.engine != RouterEngine::Raptor;
+}
+
+// Вершины остановок нумеруются по порядку справочника, поэтому остановка посадки — номер
+// исходной вершины ребра автобуса, делённый на число вершин остановки
+TieCost TransportRouter::GetEdgeTieCost(const Edge<double>& edge, const RouteItemDesc& item) const {
+    if (item.type == RouteItemType::Wait) {
+        return 0;
+    }
+    const VertexId vertices_per_stop = settings_.collapse_wait_edges ? 1 : 2;
+    return GetRideTieCost(item.bus->id, static_cast<StopId>(edge.from / vertices_per_stop));
+}
+
+void TransportRouter::ComputeEdgeTieCosts() {
+    vector<TieCost> tie_costs;
+    tie_costs.reserve(graph_->GetEdgeCount());
+    for (EdgeId edge_id = 0; edge_id < graph_->GetEdgeCount(); ++edge_id) {
+        tie_costs.push_back(GetEdgeTieCost(graph_->GetEdge(edge_id), route_items_by_edges_[edge_id]));
+    }
+    edge_tie_costs_ = make_unique<const vector<TieCost>>(move(tie_costs));
+}
+
+void TransportRouter::InitializeRouter(const TransportCatalogue& db, EngineData engine_data,
+                                       const PrecomputeSettings& precompute_settings) {
+    if (UsesGraph()) {
+        ComputeEdgeTieCosts();
+        tree_buffers_ = make_unique<ShortestPathTree::BuffersPool>(graph_->GetVertexCount());
+    }
+    switch (settings_.engine) {
+        case RouterEngine::AllPairs:
+            router_ = engine_data.routes
+                ? make_unique<Router>(*graph_, move(*engine_data.routes))
+                : make_unique<Router>(*graph_, *edge_tie_costs_, precompute_settings);
+            break;
+        case RouterEngine::Dijkstra:
+            dijkstra_router_ = make_unique<DijkstraRouter>(*graph_, *edge_tie_costs_);
+            break;
+        case RouterEngine::BidirectionalDijkstra:
+            bidirectional_dijkstra_router_ = make_unique<BidirectionalDijkstraRouter>(*graph_, *edge_tie_costs_);
+            break;
+        case RouterEngine::ContractionHierarchies:
+            contraction_router_ = engine_data.hierarchy
+                ? make_unique<ContractionRouter>(*graph_, *edge_tie_costs_, move(*engine_data.hierarchy))
+                : make_unique<ContractionRouter>(*graph_, *edge_tie_costs_);
+            break;
+        case RouterEngine::Raptor:
+            raptor_router_ = make_unique<RaptorRouter>(db, settings_.bus_wait_time, settings_.bus_velocity);
+            break;
+        case RouterEngine::AStar:
+            astar_router_ = make_unique<AStarRouter>(
+                *graph_,
+                *edge_tie_costs_,
+                engine_data.landmarks
+                    ? move(*engine_data.landmarks)
+                    : AStarRouter::ComputeLandmarks(*graph_, settings_.landmark_count),
+                MakeGeoLowerBound(db));
+            break;
+    }
+}
+
+const TransportRouter::Graph* TransportRouter::GetGraph() const {
+    return graph_.get();
+}
+
+const vector<RouteItemDesc>& TransportRouter::GetRouteItems() const {
+    return route_items_by_edges_;
+}
+
+size_t TransportRouter::GetPrunedEdgeCount() const {
+    return pruned_edge_count_;
+}
+
+// Расстояние по дорогам на любом перегоне автобуса не меньше расстояния на сфере, умноженного
+// на наименьшее по всем перегонам отношение этих расстояний. По неравенству треугольника сумма
+// расстояний на сфере вдоль пути не меньше расстояния между его концами, поэтому оценка
+// не превосходит время в пути и согласована. Без перегонов с ненулевым расстоянием оценки нет
+TransportRouter::AStarRouter::LowerBound TransportRouter::MakeGeoLowerBound(const TransportCatalogue& db) const {
+    optional<double> min_ratio;
+    for (const auto& bus : db.GetBusesRange()) {
+        const auto stops = MakeRoute(bus);
+        for (size_t index = 1; index < stops.size(); ++index) {
+            const double geo_distance = geo::ComputeDistance(stops[index - 1]->coordinates, stops[index]->coordinates);
+            if (geo_distance > 0) {
+                const double ratio = db.GetDistance(*stops[index - 1], *stops[index]) / geo_distance;
+                min_ratio = min_ratio ? min(*min_ratio, ratio) : ratio;
+            }
+        }
+    }
+    if (!min_ratio) {
+        return {};
+    }
+
+    vector<geo::Coordinates> coordinates(graph_->GetVertexCount());
+    for (const auto& stop : db.GetStopsRange()) {
+        const auto [from, to] = vertices_by_stop_[stop.id];
+        coordinates[from] = stop.coordinates;
+        coordinates[to] = stop.coordinates;
+    }
+
+    const double time_per_meter = GetRoadTime(*min_ratio);
+    return [coordinates = move(coordinates), time_per_meter](VertexId from, VertexId to) {
+        // Для почти совпадающих координат расстояние может получиться NaN
+        const double distance = geo::ComputeDistance(coordinates[from], coordinates[to]);
+        return distance > 0 ? distance * time_per_meter : 0.0;
+    };
+}
+
+size_t TransportRouter::GetVertexCount(const TransportCatalogue& db) const {
+    return db.GetStopsCount() * (settings_.collapse_wait_edges ? 1 : 2);
 }
 
 double TransportRouter::GetRoadTime(double distance) const {
     return distance / (1000 * settings_.bus_velocity) * 60;
 }
 
-void TransportRouter::FillGraphWithStops(const TransportCatalogue& db) {
-    VertexId id{0};
+void TransportRouter::BuildGraph(const TransportCatalogue& db) {
+    IndexStops(db);
+
+    GraphDraft draft;
+    FillGraphWithStops(db, draft);
+    FillGraphWithBuses(db, draft);
+
+    const size_t vertex_count = GetVertexCount(db);
+    const auto kept_edges = SortAndPruneEdges(draft, vertex_count);
+
+    vector<Edge<double>> edges;
+    edges.reserve(kept_edges.size());
+    route_items_by_edges_.reserve(kept_edges.size());
+    for (const size_t index : kept_edges) {
+        edges.push_back(draft.edges[index]);
+        route_items_by_edges_.push_back(draft.route_items[index]);
+    }
 
+    graph_ = make_unique<Graph>(vertex_count, move(edges));
+}
+
+// Вершины остановок нумеруются по порядку справочника, поэтому их не нужно хранить вместе с графом
+void TransportRouter::IndexStops(const TransportCatalogue& db) {
+    const VertexId vertices_per_stop = settings_.collapse_wait_edges ? 1 : 2;
+    vertices_by_stop_.resize(db.GetStopsCount());
+    stops_by_vertex_.assign(db.GetStopsCount() * vertices_per_stop, nullptr);
+
+    VertexId id{0};
     for (const auto& stop : db.GetStopsRange()) {
-        Edge<double> edge{id++, id++, settings_.bus_wait_time};
+        vertices_by_stop_[stop.id] = {id, id + vertices_per_stop - 1};
+        stops_by_vertex_[id] = &stop;
+        id += vertices_per_stop;
+    }
+}
 
-        vertices_by_stop_.insert({&stop, {edge.from, edge.to}});
-        auto edgeId = graph_->AddEdge(edge);
+void TransportRouter::FillGraphWithStops(const TransportCatalogue& db, GraphDraft& draft) const {
+    if (settings_.collapse_wait_edges) {
+        return;
+    }
 
-        route_items_by_edges_.insert({edgeId, {
+    for (const auto& stop : db.GetStopsRange()) {
+        const auto [from, to] = vertices_by_stop_[stop.id];
+        draft.edges.push_back({from, to, settings_.bus_wait_time});
+
+        draft.route_items.push_back({
             RouteItemType::Wait,
-            stop.name,
-            ""s,
+            &stop,
+            nullptr,
             0,
             settings_.bus_wait_time
-        }});
+        });
     }
 }
 
-void TransportRouter::FillGraphWithBuses(const TransportCatalogue& db) {
+void TransportRouter::FillGraphWithBuses(const TransportCatalogue& db, GraphDraft& draft) const {
+    const double wait_time = settings_.collapse_wait_edges ? settings_.bus_wait_time : 0.0;
+
     for (const auto& bus : db.GetBusesRange()) {
         if (!bus.stops.empty()) {
             const auto& stops = MakeRoute(bus);
 
             for (auto from = stops.begin(); from != stops.end(); ++from) {
-                auto from_id = vertices_by_stop_.at(*from).second;
+                auto from_id = vertices_by_stop_[(*from)->id].second;
 
                 double time = 0.0;
                 for (auto to = next(from); to != stops.end(); ++to) {
-                    auto to_id = vertices_by_stop_.at(*to).first;
+                    auto to_id = vertices_by_stop_[(*to)->id].first;
 
                     time += GetRoadTime(db.GetDistance(**prev(to), **to));
 
-                    Edge<double> edge{from_id, to_id, time};
-                    auto edgeId = graph_->AddEdge(edge);
+                    // При схлопнутых рёбрах ожидания посадка оплачивается ребром автобуса,
+                    // а остановка посадки нужна, чтобы восстановить элемент Wait
+                    draft.edges.push_back({from_id, to_id, wait_time + time});
 
-                    route_items_by_edges_.insert({edgeId, {
+                    draft.route_items.push_back({
                         RouteItemType::Bus,
-                        ""s,
-                        bus.name,
+                        settings_.collapse_wait_edges ? *from : nullptr,
+                        &bus,
                         static_cast<int>(distance(from, to)),
-                        edge.weight
-                    }});
+                        time
+                    });
                 }
             }
         }
     }
 }
 
+// Возвращает индексы рёбер черновика, упорядоченные по исходной вершине с сохранением порядка добавления.
+// Из параллельных рёбер между одной парой вершин (разные автобусы, петли некольцевых маршрутов)
+// оставляет ребро наименьшего ключа graph::PathKey, при равных ключах — добавленное раньше,
+// а петли удаляет совсем. Поиск по ключам и так выбирал бы именно оставшиеся рёбра,
+// поэтому ответы не меняются
+vector<size_t> TransportRouter::SortAndPruneEdges(const GraphDraft& draft, size_t vertex_count) {
+    static constexpr size_t NO_EDGE = numeric_limits<size_t>::max();
+
+    vector<size_t> order(draft.edges.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&draft](size_t lhs, size_t rhs) {
+        return draft.edges[lhs].from < draft.edges[rhs].from;
+    });
+
+    vector<PathKey<double>> keys;
+    keys.reserve(draft.edges.size());
+    for (size_t index = 0; index < draft.edges.size(); ++index) {
+        keys.push_back({draft.edges[index].weight, GetEdgeTieCost(draft.edges[index], draft.route_items[index])});
+    }
+
+    vector<size_t> best_edge_by_target(vertex_count, NO_EDGE);
+    vector<bool> is_kept(draft.edges.size(), false);
+    vector<VertexId> targets;
+
+    for (auto group_begin = order.begin(); group_begin != order.end();) {
+        const VertexId from = draft.edges[*group_begin].from;
+        auto group_end = group_begin;
+        for (; group_end != order.end() && draft.edges[*group_end].from == from; ++group_end) {
+            const auto& edge = draft.edges[*group_end];
+            if (edge.to == from) {
+                continue;
+            }
+            size_t& best_edge = best_edge_by_target[edge.to];
+            if (best_edge == NO_EDGE) {
+                targets.push_back(edge.to);
+                best_edge = *group_end;
+            } else if (keys[*group_end] < keys[best_edge]) {
+                best_edge = *group_end;
+            }
+        }
+        for (const VertexId target : targets) {
+            is_kept[best_edge_by_target[target]] = true;
+            best_edge_by_target[target] = NO_EDGE;
+        }
+        targets.clear();
+        group_begin = group_end;
+    }
+
+    order.erase(remove_if(order.begin(), order.end(), [&is_kept](size_t index) {
+        return !is_kept[index];
+    }), order.end());
+
+    pruned_edge_count_ = draft.edges.size() - order.size();
+    return order;
+}
+
 } // namespace transport_catalogue
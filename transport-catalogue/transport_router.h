@@ -3,6 +3,13 @@
 #include "graph.h"
 #include "transport_catalogue.h"
 #include "router.h"
+#include "dijkstra_router.h"
+#include "bidirectional_dijkstra_router.h"
+#include "contraction_hierarchy_router.h"
+#include "astar_router.h"
+#include "raptor_router.h"
+#include "shortest_path_tree.h"
+#include "lru_cache.h"
 
 #include <optional>
 #include <string>
@@ -15,9 +22,31 @@ struct SerializationSettings {
     std::string file;
 };
 
+// Способ поиска маршрутов: предподсчёт таблицы всех пар (Floyd–Warshall),
+// поиск Дейкстры по требованию без предподсчёта (одно- или двунаправленный),
+// поиск по иерархии сжатия, построенной при создании базы,
+// поиск по раундам (RAPTOR) прямо по маршрутам автобусов, без графа
+// либо поиск A* с оценками по координатам остановок и ориентирам, посчитанным при создании базы
+enum class RouterEngine {
+    AllPairs,
+    Dijkstra,
+    ContractionHierarchies,
+    Raptor,
+    AStar,
+    BidirectionalDijkstra
+};
+
 struct RoutingSettings {
     double bus_wait_time;
     double bus_velocity;
+    RouterEngine engine = RouterEngine::AllPairs;
+    // Одна вершина на остановку вместо двух, соединённых ребром ожидания:
+    // время ожидания учитывается в весе каждого ребра автобуса
+    bool collapse_wait_edges = false;
+    // Число ориентиров для оценок движка RouterEngine::AStar, 0 оставляет только оценку по координатам.
+    // Таблицы ориентиров занимают 2 × landmark_count × V весов, а выигрыш от новых ориентиров быстро падает
+    static constexpr size_t MAX_LANDMARK_COUNT = 32;
+    size_t landmark_count = 8;
 };
 
 enum class RouteItemType {
@@ -25,33 +54,159 @@ enum class RouteItemType {
     Bus
 };
 
+// Остановка и автобус ссылаются на объекты справочника, имена берутся из них только при выводе ответа.
+// У элемента Wait задана остановка, у элемента Bus — автобус
+// (и остановка посадки, если рёбра ожидания схлопнуты)
 struct RouteItemDesc {
     RouteItemType type;
-    std::string stop_name;
-    std::string bus_name;
-    int span_count;
-    double time;
+    StopPtr stop = nullptr;
+    BusPtr bus = nullptr;
+    int span_count = 0;
+    double time = 0.0;
 };
 
 class TransportRouter {
 public:
     using Router = graph::Router<double>;
+    using DijkstraRouter = graph::DijkstraRouter<double>;
+    using BidirectionalDijkstraRouter = graph::BidirectionalDijkstraRouter<double>;
+    using ContractionRouter = graph::ContractionHierarchyRouter<double>;
+    using AStarRouter = graph::AStarRouter<double>;
+    using ShortestPathTree = graph::ShortestPathTree<double>;
     using Graph = Router::Graph;
     using RouteResult = std::pair<double, std::vector<RouteItemDesc>>;
+    // nullptr, если маршрута нет
+    using RouteResultPtr = std::shared_ptr<const RouteResult>;
+
+    // Граф маршрутов и описания его рёбер, индексированные по номеру ребра
+    struct RoutingGraph {
+        Graph graph;
+        std::vector<RouteItemDesc> route_items;
+    };
+
+    // Предподсчёт движка маршрутизации, загруженный из базы. Заполняется только поле выбранного движка,
+    // а если оно пусто, предподсчёт выполняется заново
+    struct EngineData {
+        std::optional<Router::RoutesInternalData> routes;
+        std::optional<ContractionRouter::Hierarchy> hierarchy;
+        std::optional<AStarRouter::Landmarks> landmarks;
+    };
+
+    // Матрица маршрутов построчно: ячейка (i, j) описывает маршрут из i-й остановки from в j-ю остановку to
+    struct RouteMatrix {
+        size_t column_count = 0;
+        // Пустая ячейка — маршрута нет
+        std::vector<std::optional<double>> total_times;
+        // Суммарное число перегонов маршрута, заполняется только по запросу
+        std::vector<int> span_counts;
+    };
+
+    // Остановка и наименьшее время в пути до неё
+    struct ReachableStop {
+        StopPtr stop;
+        double time;
+    };
+
+    static constexpr size_t DEFAULT_ROUTE_CACHE_CAPACITY = 4096;
+    static constexpr size_t MIN_SHARED_SEARCH_TARGETS = 2;
+
+    TransportRouter(RoutingSettings settings, const TransportCatalogue& transport_catalogue,
+                    const graph::PrecomputeSettings& precompute_settings = {});
+    // Использует готовый граф (например, загруженный из базы) вместо построения по справочнику.
+    // Выбрасывает std::invalid_argument, если граф не соответствует справочнику и настройкам
+    // или отсутствует, хотя выбранный движок работает по графу
+    TransportRouter(RoutingSettings settings, std::optional<RoutingGraph> routing_graph,
+                    EngineData engine_data, const TransportCatalogue& transport_catalogue);
+
+    // Готовые ответы запоминаются в LRU-кеше по паре остановок. Из маршрутов равного времени все движки
+    // выбирают один и тот же: с наименьшим числом поездок, а при равном — с наименьшей суммой
+    // стоимостей GetRideTieCost, поэтому элементы ответа от движка не зависят
+    RouteResultPtr BuildRoute(const Stop& from, const Stop& to) const;
+
+    // Маршруты из from в каждую из остановок to в том же порядке. Движок Dijkstra отвечает на все
+    // промахи кеша одним деревом кратчайших путей из from, если промахов хотя бы MIN_SHARED_SEARCH_TARGETS.
+    // Дерево выбирает среди равных по времени те же маршруты, что и любой движок, но остальные движки
+    // находят один маршрут быстрее поиска Дейкстры, поэтому для них каждый маршрут ищется как в BuildRoute
+    std::vector<RouteResultPtr> BuildRoutes(const Stop& from, const std::vector<StopPtr>& to) const;
+
+    // Считает только времена (и по запросу числа перегонов), не собирая элементы маршрутов.
+    // Движок AllPairs читает ячейки из таблицы, остальные движки по графу строят одно дерево
+    // кратчайших путей на каждую остановку from, RAPTOR выполняет один поиск без цели на каждую остановку from.
+    // Ячейки не попадают в кеш ответов BuildRoute
+    RouteMatrix BuildRouteMatrix(const std::vector<StopPtr>& from, const std::vector<StopPtr>& to,
+                                 bool with_span_counts) const;
+
+    // Все остановки, достижимые из from не дольше чем за max_time, по возрастанию времени, при равенстве по названию.
+    // Движки по графу выполняют один поиск Дейкстры, прерываемый, когда вершина кучи тяжелее max_time
+    std::vector<ReachableStop> FindReachableStops(const Stop& from, double max_time) const;
+
+    // Пересоздаёт кеш ответов с новой ёмкостью, 0 отключает кеширование.
+    // Нельзя вызывать одновременно с BuildRoute
+    void SetRouteCacheCapacity(size_t capacity);
+
+    cache::CacheStats GetRouteCacheStats() const;
+
+    const RoutingSettings& GetSettings() const;
 
-    TransportRouter(RoutingSettings settings, const TransportCatalogue& transport_catalogue);
-    TransportRouter(RoutingSettings settings, Router::RoutesInternalData router_data, const TransportCatalogue& transport_catalogue);
+    // Таблица маршрутов есть только у движка RouterEngine::AllPairs, иначе nullptr
+    const Router* GetRouter() const;
 
-    std::optional<RouteResult> BuildRoute(const Stop& from, const Stop& to) const;
+    // Иерархия сжатия есть только у движка RouterEngine::ContractionHierarchies, иначе nullptr
+    const ContractionRouter* GetContractionRouter() const;
 
-    const RoutingSettings& GetSettings() const;
+    // Ориентиры есть только у движка RouterEngine::AStar, иначе nullptr
+    const AStarRouter* GetAStarRouter() const;
+
+    // Граф строится для всех движков, кроме RouterEngine::Raptor, иначе nullptr
+    const Graph* GetGraph() const;
 
-    const Router& GetRouter() const;
+    // Описания рёбер графа, индексированные по номеру ребра
+    const std::vector<RouteItemDesc>& GetRouteItems() const;
+
+    // Количество рёбер, удалённых при построении графа как более дорогие дубликаты
+    size_t GetPrunedEdgeCount() const;
 
 private:
-    void FillGraphWithStops(const TransportCatalogue& db);
+    // Рёбра и их описания в порядке добавления, до упорядочивания в CSR-граф
+    struct GraphDraft {
+        std::vector<graph::Edge<double>> edges;
+        std::vector<RouteItemDesc> route_items;
+    };
+
+    using RouteCache = cache::LruCache<TransportCatalogue::StopsPair, RouteResultPtr, StopsPairHasher>;
+
+    size_t GetVertexCount(const TransportCatalogue& db) const;
+
+    RouteResultPtr ComputeRoute(const Stop& from, const Stop& to) const;
+
+    std::optional<Router::RouteInfo> FindRoute(graph::VertexId from, graph::VertexId to) const;
+
+    bool UsesGraph() const;
 
-    void FillGraphWithBuses(const TransportCatalogue& db);
+    graph::TieCost GetEdgeTieCost(const graph::Edge<double>& edge, const RouteItemDesc& item) const;
+
+    void ComputeEdgeTieCosts();
+
+    int CountSpans(const std::vector<graph::EdgeId>& edges) const;
+
+    AStarRouter::LowerBound MakeGeoLowerBound(const TransportCatalogue& db) const;
+
+    RouteResultPtr ComputeRaptorRoute(const Stop& from, const Stop& to) const;
+
+    RouteResultPtr MakeRouteResult(const Router::RouteInfo& route) const;
+
+    void InitializeRouter(const TransportCatalogue& db, EngineData engine_data,
+                          const graph::PrecomputeSettings& precompute_settings = {});
+
+    void BuildGraph(const TransportCatalogue& db);
+
+    void IndexStops(const TransportCatalogue& db);
+
+    void FillGraphWithStops(const TransportCatalogue& db, GraphDraft& draft) const;
+
+    void FillGraphWithBuses(const TransportCatalogue& db, GraphDraft& draft) const;
+
+    std::vector<size_t> SortAndPruneEdges(const GraphDraft& draft, size_t vertex_count);
 
     double GetRoadTime(double distance) const;
 
@@ -59,9 +214,28 @@ private:
 
     std::unique_ptr<Graph> graph_;
     std::unique_ptr<Router> router_;
-
-    std::unordered_map<StopPtr, std::pair<graph::VertexId, graph::VertexId>> vertices_by_stop_;
-    std::unordered_map<graph::EdgeId, RouteItemDesc> route_items_by_edges_;
+    std::unique_ptr<DijkstraRouter> dijkstra_router_;
+    std::unique_ptr<BidirectionalDijkstraRouter> bidirectional_dijkstra_router_;
+    std::unique_ptr<ContractionRouter> contraction_router_;
+    std::unique_ptr<RaptorRouter> raptor_router_;
+    std::unique_ptr<AStarRouter> astar_router_;
+    // Буферы деревьев кратчайших путей для BuildRoutes, BuildRouteMatrix и FindReachableStops,
+    // есть только у движков по графу
+    std::unique_ptr<ShortestPathTree::BuffersPool> tree_buffers_;
+
+    // Вершины прибытия и отправления, индексируется номером остановки
+    std::vector<std::pair<graph::VertexId, graph::VertexId>> vertices_by_stop_;
+    std::vector<RouteItemDesc> route_items_by_edges_;
+    // Стоимости выбора рёбер графа для ключа graph::PathKey, индексированные по номеру ребра.
+    // В базе не хранятся: они определяются описаниями рёбер. Движки ссылаются на них,
+    // поэтому, как и граф, они лежат в куче и не перемещаются вместе с маршрутизатором
+    std::unique_ptr<const std::vector<graph::TieCost>> edge_tie_costs_;
+    // Остановка, в вершину прибытия на которую ведёт индекс, иначе nullptr
+    std::vector<StopPtr> stops_by_vertex_;
+
+    size_t pruned_edge_count_ = 0;
+
+    std::unique_ptr<RouteCache> route_cache_ = std::make_unique<RouteCache>(DEFAULT_ROUTE_CACHE_CAPACITY);
 };
 
 }